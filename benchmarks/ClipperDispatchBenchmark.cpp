@@ -0,0 +1,109 @@
+#include <juce_dsp/juce_dsp.h>
+#include "NonInvertingOpAmpClipper.h"
+#include "ClipperSelector.h"
+
+#include <chrono>
+#include <cstdio>
+
+// Compares the old per-sample virtual dispatch with the statically
+// dispatched ClipperBase, and with ClipperSelector's once-per-block switch.
+namespace
+{
+    struct PassThroughClipper : public ClipperBase<PassThroughClipper, float>
+    {
+        void clearState() {}
+    };
+
+    // Stand-in for the previous ClipperBase, which made one virtual call per sample
+    struct VirtualClipper
+    {
+        virtual ~VirtualClipper() = default;
+        virtual void reset (float Fs) = 0;
+        virtual float processSingleSample (float Vin, size_t channel) = 0;
+    };
+
+    template <typename Clipper>
+    struct VirtualWrapper : public VirtualClipper
+    {
+        void reset (float Fs) override                                 { clipper.reset (Fs); }
+        float processSingleSample (float Vin, size_t channel) override { return clipper.processSample (Vin, channel); }
+
+        Clipper clipper;
+    };
+
+    constexpr double sampleRate = 44100.0 * 4.0;
+    constexpr size_t blockSize = 512;
+    constexpr int numBlocks = 4000;
+
+    template <typename Fn>
+    double nanosecondsPerSample (Fn&& processBlock)
+    {
+        processBlock();
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int block = 0; block < numBlocks; ++block)
+            processBlock();
+
+        const auto elapsed = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start).count();
+        return elapsed / (double) (numBlocks * blockSize);
+    }
+
+    template <typename Clipper>
+    void run (const char* name, std::unique_ptr<VirtualClipper> virtualClipper, juce::AudioBuffer<float>& input)
+    {
+        juce::AudioBuffer<float> output (1, (int) blockSize);
+        Clipper clipper;
+        clipper.reset ((float) sampleRate);
+        virtualClipper->reset ((float) sampleRate);
+
+        const auto* src = input.getReadPointer (0);
+        auto* dst = output.getWritePointer (0);
+
+        const auto virtualTime = nanosecondsPerSample ([&]
+        {
+            for (size_t i = 0; i < blockSize; ++i)
+                dst[i] = virtualClipper->processSingleSample (src[i], 0);
+        });
+
+        const auto staticTime = nanosecondsPerSample ([&]
+        {
+            juce::dsp::AudioBlock<float> inBlock (input), outBlock (output);
+            juce::dsp::ProcessContextNonReplacing<float> context (inBlock, outBlock);
+            clipper.process (context);
+        });
+
+        std::printf ("%-24s virtual %8.2f ns/sample   static %8.2f ns/sample   saved %8.2f ns/sample\n",
+                     name, virtualTime, staticTime, virtualTime - staticTime);
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ignoreUnused (argc, argv);
+
+    juce::AudioBuffer<float> input (1, (int) blockSize);
+
+    for (int i = 0; i < input.getNumSamples(); ++i)
+        input.setSample (0, i, 0.5f * std::sin (juce::MathConstants<float>::twoPi * 220.0f * (float) i / (float) sampleRate));
+
+    run<PassThroughClipper> ("PassThroughClipper", std::make_unique<VirtualWrapper<PassThroughClipper>>(), input);
+    run<NonInvertingOpAmpClipper<float>> ("NonInvertingOpAmpClipper", std::make_unique<VirtualWrapper<NonInvertingOpAmpClipper<float>>>(), input);
+
+    ClipperSelector<PassThroughClipper, NonInvertingOpAmpClipper<float>> selector;
+    selector.reset ((float) sampleRate);
+    selector.setIndex (1);
+
+    juce::AudioBuffer<float> output (1, (int) blockSize);
+
+    const auto selectorTime = nanosecondsPerSample ([&]
+    {
+        juce::dsp::AudioBlock<float> inBlock (input), outBlock (output);
+        juce::dsp::ProcessContextNonReplacing<float> context (inBlock, outBlock);
+        selector.process (context);
+    });
+
+    std::printf ("%-24s selector %7.2f ns/sample\n", "NonInvertingOpAmpClipper", selectorTime);
+
+    return 0;
+}
@@ -0,0 +1,341 @@
+#include <juce_dsp/juce_dsp.h>
+#include "NonInvertingOpAmpClipper.h"
+#include "WDFOpAmpClipper.h"
+#include "ADAAClipper.h"
+#include "DKClipper.h"
+#include "Netlists.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Times the diode functions and NonInvertingOpAmpClipper's solver, and
+// reports how many Newton iterations and backtracking steps each input
+// level and drive setting needs. Built with SYN_SOLVER_STATS=1.
+namespace
+{
+    constexpr double sampleRate = 44100.0 * 4.0;
+    constexpr size_t numSamples = 1 << 16;
+
+    float sink = 0.0f;
+
+    template <typename Fn>
+    double nanosecondsPerCall (size_t numCalls, Fn&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto elapsed = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start).count();
+
+        return elapsed / (double) numCalls;
+    }
+
+    std::vector<float> makeSine (float amplitude, float frequency, double rate = sampleRate)
+    {
+        std::vector<float> signal (numSamples);
+
+        for (size_t i = 0; i < numSamples; ++i)
+            signal[i] = amplitude * std::sin (juce::MathConstants<float>::twoPi * frequency * (float) i / (float) rate);
+
+        return signal;
+    }
+
+    // The drum loop from SYNRender's --signal=drums: a kick on every beat, a
+    // snare on 2 and 4 and hats on eighths at 120 BPM
+    std::vector<float> makeDrums (double seconds, double rate = sampleRate)
+    {
+        constexpr auto twoPi = juce::MathConstants<double>::twoPi;
+        std::vector<float> signal ((size_t) (seconds * rate));
+        juce::Random random (1);
+
+        for (size_t i = 0; i < signal.size(); ++i)
+        {
+            const auto t = (double) i / rate;
+            const auto beat = t * 2.0;
+            const auto beatPhase = (beat - std::floor (beat)) * 0.5;
+            const auto eighthPhase = (beat * 2.0 - std::floor (beat * 2.0)) * 0.25;
+            const auto isBackbeat = ((int) std::floor (beat) % 2) == 1;
+
+            const auto kick = std::sin (twoPi * (45.0 * beatPhase + 4.0 * (1.0 - std::exp (-beatPhase * 30.0))))
+                                * std::exp (-beatPhase * 12.0);
+            const auto noise = 2.0 * random.nextDouble() - 1.0;
+            const auto snare = isBackbeat ? noise * std::exp (-beatPhase * 25.0) : 0.0;
+            const auto hat = noise * std::exp (-eighthPhase * 200.0);
+
+            signal[i] = (float) (0.6 * kick + 0.3 * snare + 0.1 * hat);
+        }
+
+        return signal;
+    }
+
+    //==============================================================================
+    void benchmarkDiodes()
+    {
+        std::vector<float> voltages (4096);
+
+        for (size_t i = 0; i < voltages.size(); ++i)
+            voltages[i] = -0.8f + 1.6f * (float) i / (float) (voltages.size() - 1);
+
+        const auto numCalls = voltages.size() * 256;
+
+        auto run = [&] (const char* name, auto&& fn)
+        {
+            const auto ns = nanosecondsPerCall (numCalls, [&]
+            {
+                for (int repeat = 0; repeat < 256; ++repeat)
+                    for (auto v : voltages)
+                        sink += fn (v);
+            });
+
+            std::printf ("  %-40s %8.2f ns/call\n", name, ns);
+        };
+
+        using Clipper = ClipperBase<NonInvertingOpAmpClipper<float>, float>;
+        const auto& pair = Clipper::clippingDiodePair;
+
+        std::printf ("Diode functions\n");
+        run ("positiveDiode", [] (float v) { return Clipper::positiveDiode (v); });
+        run ("positiveDiode (derivative)", [] (float v) { return Clipper::positiveDiode (v, true); });
+        run ("negativeDiode", [] (float v) { return Clipper::negativeDiode (v); });
+        run ("negativeDiode (derivative)", [] (float v) { return Clipper::negativeDiode (v, true); });
+        run ("symmetricDiodes", [] (float v) { return Clipper::symmetricDiodes (v); });
+        run ("symmetricDiodes (derivative)", [] (float v) { return Clipper::symmetricDiodes (v, true); });
+        run ("pos + neg, value and derivative", [] (float v)
+        {
+            return Clipper::positiveDiode (v) + Clipper::negativeDiode (v)
+                 + Clipper::positiveDiode (v, true) + Clipper::negativeDiode (v, true);
+        });
+        run ("DiodePair exact, value and derivative", [&pair] (float v)
+        {
+            float current, conductance;
+            pair.evaluate<DiodePrecision::exact> (v, current, conductance);
+            return current + conductance;
+        });
+        run ("DiodePair fast, value and derivative", [&pair] (float v)
+        {
+            float current, conductance;
+            pair.evaluate<DiodePrecision::fast> (v, current, conductance);
+            return current + conductance;
+        });
+
+       #if JUCE_USE_SIMD
+        using Vec = SIMDMath::Vec;
+
+        const auto ns = nanosecondsPerCall (numCalls, [&]
+        {
+            for (int repeat = 0; repeat < 256; ++repeat)
+            {
+                for (size_t i = 0; i < voltages.size(); i += Vec::size())
+                {
+                    Vec current, conductance;
+                    pair.evaluate (Vec::fromRawArray (voltages.data() + i), current, conductance);
+                    sink += (current + conductance).sum();
+                }
+            }
+        });
+
+        std::printf ("  %-40s %8.2f ns/value\n", "DiodePair simd, value and derivative", ns);
+       #endif
+    }
+
+    //==============================================================================
+    template <typename Clipper = NonInvertingOpAmpClipper<float>, typename Configure>
+    void benchmarkSolver (const char* name, Configure&& configure, double rate = sampleRate)
+    {
+        std::printf ("\n%s, %.1f kHz\n", name, rate / 1000.0);
+        std::printf ("  %8s %8s %10s %10s %8s %12s %10s\n", "level", "drive", "ns/sample", "avg iter", "max iter", "backtracks", "cap hits");
+
+        for (auto level : { 0.01f, 0.1f, 1.0f })
+        {
+            for (auto driveDb : { 0.0f, 20.0f, 40.0f, 60.0f })
+            {
+                // The table solver only runs at prepared rates
+                Clipper clipper;
+                configure (clipper);
+                clipper.prepareSampleRates ({ (float) rate });
+                clipper.reset ((float) rate);
+                clipper.resetSolverStats();
+
+                const auto input = makeSine (level * juce::Decibels::decibelsToGain (driveDb), 220.0f, rate);
+
+                const auto ns = nanosecondsPerCall (numSamples, [&]
+                {
+                    for (auto x : input)
+                        sink += (float) clipper.processSample (x);
+                });
+
+                const auto& stats = clipper.getSolverStats();
+                const auto perSolve = [&stats] (uint64_t count) { return stats.solves > 0 ? (double) count / (double) stats.solves : 0.0; };
+
+                std::printf ("  %8.2f %6.0fdB %10.2f %10.2f %8u %12.3f %9.2f%%\n",
+                             level, driveDb, ns, stats.getAverageIterations(), stats.maxIterations,
+                             perSolve (stats.backtracks), 100.0 * perSolve (stats.capHits));
+            }
+        }
+    }
+
+    // One bar of the drum loop per drive setting. Unlike the sine, its
+    // transients and decays are what the predictors meet on real material.
+    template <typename Configure>
+    void benchmarkProgram (const char* name, Configure&& configure)
+    {
+        std::printf ("\n%s, drum loop\n", name);
+        std::printf ("  %8s %10s %10s %8s %12s %10s\n", "drive", "ns/sample", "avg iter", "max iter", "backtracks", "cap hits");
+
+        const auto drums = makeDrums (2.0);
+
+        for (auto driveDb : { 0.0f, 20.0f, 40.0f })
+        {
+            NonInvertingOpAmpClipper<float> clipper;
+            configure (clipper);
+            clipper.reset ((float) sampleRate);
+            clipper.resetSolverStats();
+
+            const auto gain = juce::Decibels::decibelsToGain (driveDb);
+
+            const auto ns = nanosecondsPerCall (drums.size(), [&]
+            {
+                for (auto x : drums)
+                    sink += clipper.processSample (x * gain);
+            });
+
+            const auto& stats = clipper.getSolverStats();
+            const auto perSolve = [&stats] (uint64_t count) { return stats.solves > 0 ? (double) count / (double) stats.solves : 0.0; };
+
+            std::printf ("  %6.0fdB %10.2f %10.2f %8u %12.3f %9.2f%%\n",
+                         driveDb, ns, stats.getAverageIterations(), stats.maxIterations,
+                         perSolve (stats.backtracks), 100.0 * perSolve (stats.capHits));
+        }
+    }
+
+    // Timing only, for the circuits without solver statistics
+    template <typename Clipper>
+    void benchmarkTiming (const char* name)
+    {
+        std::printf ("\n%s\n", name);
+        std::printf ("  %8s %8s %10s\n", "level", "drive", "ns/sample");
+
+        for (auto level : { 0.01f, 0.1f, 1.0f })
+        {
+            for (auto driveDb : { 0.0f, 20.0f, 40.0f, 60.0f })
+            {
+                Clipper clipper;
+                clipper.reset ((float) sampleRate);
+
+                const auto input = makeSine (level * juce::Decibels::decibelsToGain (driveDb), 220.0f);
+
+                const auto ns = nanosecondsPerCall (numSamples, [&]
+                {
+                    for (auto x : input)
+                        sink += clipper.processSample (x);
+                });
+
+                std::printf ("  %8.2f %6.0fdB %10.2f\n", level, driveDb, ns);
+            }
+        }
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ignoreUnused (argc, argv);
+
+    benchmarkDiodes();
+
+    benchmarkSolver ("Newton-Raphson, exact diodes", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setDiodePrecision (DiodePrecision::exact);
+    });
+
+    benchmarkSolver ("Newton-Raphson, fast diodes", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setDiodePrecision (DiodePrecision::fast);
+    });
+
+    benchmarkSolver ("Newton-Raphson, fast diodes, residual criterion only", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setDiodePrecision (DiodePrecision::fast);
+        clipper.setConvergenceCriterion (NonInvertingOpAmpClipper<float>::ConvergenceCriterion::residual);
+    });
+
+    benchmarkSolver ("Newton-Raphson, fast diodes, linear extrapolation", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setDiodePrecision (DiodePrecision::fast);
+        clipper.setPredictor (NonInvertingOpAmpClipper<float>::Predictor::linearExtrapolation);
+    });
+
+    benchmarkSolver ("Newton-Raphson, fast diodes, explicit estimate", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setDiodePrecision (DiodePrecision::fast);
+        clipper.setPredictor (NonInvertingOpAmpClipper<float>::Predictor::explicitEstimate);
+    });
+
+    benchmarkSolver ("Lookup table (iterations are out-of-range fallbacks)", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setSolverMode (NonInvertingOpAmpClipper<float>::SolverMode::lookupTable);
+    });
+
+    // The predictors and criteria on program material, against the residual
+    // criterion from the previous sample that the solver used to run
+    benchmarkProgram ("Previous sample, residual criterion only", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setConvergenceCriterion (NonInvertingOpAmpClipper<float>::ConvergenceCriterion::residual);
+    });
+
+    benchmarkProgram ("Previous sample, step size criterion", [] (NonInvertingOpAmpClipper<float>&) {});
+
+    benchmarkProgram ("Linear extrapolation, step size criterion", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setPredictor (NonInvertingOpAmpClipper<float>::Predictor::linearExtrapolation);
+    });
+
+    benchmarkProgram ("Explicit estimate, step size criterion", [] (NonInvertingOpAmpClipper<float>& clipper)
+    {
+        clipper.setPredictor (NonInvertingOpAmpClipper<float>::Predictor::explicitEstimate);
+    });
+
+    // Float against double solves, and against the whole circuit in double
+    // as it runs on double blocks. In float the residual criterion alone
+    // runs into the iteration cap wherever rounding holds the residual above
+    // thr, and the step size criterion is what stops it; in double the
+    // residual converges, so either criterion works.
+    const auto mixed = [] (NonInvertingOpAmpClipper<float>& clipper, NonInvertingOpAmpClipper<float>::ConvergenceCriterion criterion)
+    {
+        clipper.setDiodePrecision (DiodePrecision::exact);
+        clipper.setSolverPrecision (NonInvertingOpAmpClipper<float>::SolverPrecision::mixed);
+        clipper.setConvergenceCriterion (criterion);
+    };
+
+    for (auto rate : { sampleRate, 192000.0 * 16.0 })
+    {
+        benchmarkSolver ("Newton-Raphson, exact diodes, residual criterion only", [] (NonInvertingOpAmpClipper<float>& clipper)
+        {
+            clipper.setDiodePrecision (DiodePrecision::exact);
+            clipper.setConvergenceCriterion (NonInvertingOpAmpClipper<float>::ConvergenceCriterion::residual);
+        }, rate);
+
+        benchmarkSolver ("Mixed precision, residual criterion only", [&mixed] (NonInvertingOpAmpClipper<float>& clipper)
+        {
+            mixed (clipper, NonInvertingOpAmpClipper<float>::ConvergenceCriterion::residual);
+        }, rate);
+
+        benchmarkSolver ("Mixed precision, step size criterion", [&mixed] (NonInvertingOpAmpClipper<float>& clipper)
+        {
+            mixed (clipper, NonInvertingOpAmpClipper<float>::ConvergenceCriterion::stepSize);
+        }, rate);
+
+        benchmarkSolver<NonInvertingOpAmpClipper<double>> ("Double precision, residual criterion only", [] (NonInvertingOpAmpClipper<double>& clipper)
+        {
+            clipper.setDiodePrecision (DiodePrecision::exact);
+            clipper.setConvergenceCriterion (NonInvertingOpAmpClipper<double>::ConvergenceCriterion::residual);
+        }, rate);
+    }
+
+    benchmarkTiming<WDFOpAmpClipper<float>> ("Wave digital filter");
+    benchmarkTiming<ADAAClipper<1, float>> ("First-order ADAA, memoryless op-amp clipper");
+    benchmarkTiming<ADAAClipper<2, float>> ("Second-order ADAA, memoryless op-amp clipper");
+    benchmarkTiming<DKClipper<Netlists::NonInvertingOpAmp, float>> ("DK-method, op-amp clipper netlist");
+    benchmarkTiming<DKClipper<Netlists::SymmetricDiodeClipper, float>> ("DK-method, symmetric diode clipper netlist");
+
+    std::printf ("\n(checksum %g)\n", (double) sink);
+    return 0;
+}
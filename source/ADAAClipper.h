@@ -0,0 +1,217 @@
+#pragma once
+
+#include "ClipperBase.h"
+#include "WDF.h"
+
+// The non-inverting op-amp clipper as a memoryless nonlinearity with
+// antiderivative anti-aliasing (Parker et al., "Reducing the Aliasing of
+// Nonlinear Waveshaping Using Continuous-Time Convolution", 2016; Bilbao et
+// al., "Antiderivative Antialiasing for Memoryless Nonlinearities", 2017).
+//
+// As in the WDF model, the current through R4 and C1 is set by Vin alone, and
+// the voltage across the feedback network is added to Vin at the output. C1
+// is kept as a high-pass on that current; C2 is dropped, which leaves the
+// diode voltage a function of the current with a closed form in the Wright
+// omega function, and so are its first two antiderivatives. Rather than
+// sampling it, the output is its average over the segment between the last
+// two inputs (first order) or its triangle-weighted average over the last
+// three (second order), which removes most of the harmonics that would
+// alias. The output is delayed by half a sample or one sample.
+template <int Order, typename SampleType>
+class ADAAClipper : public ClipperBase<ADAAClipper<Order, SampleType>, SampleType>
+{
+public:
+	static_assert (Order == 1 || Order == 2, "First or second order antiderivatives");
+
+	ADAAClipper() {}
+	~ADAAClipper() {}
+
+	bool isQuiescent(float tolerance) const
+	{
+		for (const auto& state : states)
+			if (std::abs(state.x1) > tolerance || std::abs(state.x2) > tolerance || std::abs(state.u1) > tolerance || std::abs(state.u2) > tolerance)
+				return false;
+
+		return true;
+	}
+
+	// Every antiderivative is zero at rest, so no cached values need
+	// recomputing
+	void clearState()
+	{
+		states.fill({});
+	}
+
+	float getTimeConstant() const
+	{
+		return (float) (R4 * C1);
+	}
+
+	float getLatency() const
+	{
+		return 0.5f * (float) Order;
+	}
+
+private:
+	friend class ClipperBase<ADAAClipper<Order, SampleType>, SampleType>;
+	using Base = ClipperBase<ADAAClipper<Order, SampleType>, SampleType>;
+	using Base::Ts;
+	using Base::clippingDiodePair;
+
+	static constexpr double R4 = 4700.0;
+	static constexpr double C1 = 47e-9;
+	static constexpr double R3 = 551000.0;
+
+	// The feedback network in terms of u = R4 * i, the high-passed input.
+	// Forward, Vd = k u + c0 - nVt w(z) with z = (k u + c0) / nVt + log(c0 / nVt),
+	// which is zero at u = 0, and the network is odd in u.
+	static constexpr double nVt = 1.0 / (double) clippingDiodePair.invNVt;
+	static constexpr double k = R3 / R4;
+	static constexpr double c0 = (double) clippingDiodePair.Is * R3;
+	static constexpr double w0 = c0 / nVt;
+	const double logW0 = std::log(w0);
+
+	// The antiderivatives cancel to about the size of Vd out of terms of
+	// k u^3, so they are evaluated in double, and inputs closer together
+	// than relativeTolerance of their size, plus absoluteTolerance volts,
+	// are treated as equal. Second order divides by the spread twice, so its
+	// rounding error grows faster as the spread shrinks and it needs the
+	// wider relative tolerance. Against quadrature of the diode voltage over
+	// |u| from 0.1 mV to 5 V, the worst errors are 1.1e-8 V (first order)
+	// and 6.4e-6 V (second order); a relative 1e-5 for the second order
+	// gives 3.8e-4 V, from rounding at the top of the range.
+	static constexpr double relativeTolerance = Order == 1 ? 1e-5 : 1e-4;
+	static constexpr double absoluteTolerance = 1e-8;
+
+	struct State
+	{
+		double x1 = 0.0, x2 = 0.0;     // previous inputs
+		double u1 = 0.0, u2 = 0.0;     // previous high-passed inputs
+		double F1 = 0.0, F2 = 0.0;     // antiderivative of order Order at u1 and u2
+	};
+
+	std::array<State, Base::maxChannels> states;
+
+	double b0 = 1.0, a1 = 0.0;
+
+	static double omega(double z)
+	{
+		return WDF::omega<5>(z);
+	}
+
+	double getZ(double v) const
+	{
+		return (k * v + c0) / nVt + logW0;
+	}
+
+	// v + log(w) = z, so integrating nVt w(z(v)) dv with dz = k / nVt dv gives
+	// these polynomials in w
+	static double omegaIntegral(double w)       { return w + 0.5 * w * w; }
+	static double omegaSecondIntegral(double w) { return w + 0.75 * w * w + w * w * w / 6.0; }
+
+	double diodeVoltage(double u) const
+	{
+		const double v = std::abs(u);
+		return std::copysign(k * v + c0 - nVt * omega(getZ(v)), u);
+	}
+
+	// Even, zero at u = 0
+	double diodeVoltageIntegral(double u) const
+	{
+		const double v = std::abs(u);
+		const double w = omega(getZ(v));
+
+		return v * (0.5 * k * v + c0) - nVt * nVt / k * (omegaIntegral(w) - omegaIntegral(w0));
+	}
+
+	// Odd, zero at u = 0
+	double diodeVoltageSecondIntegral(double u) const
+	{
+		const double v = std::abs(u);
+		const double w = omega(getZ(v));
+
+		const double G = v * v * (k * v / 6.0 + 0.5 * c0)
+			- nVt * nVt / k * (nVt / k * (omegaSecondIntegral(w) - omegaSecondIntegral(w0)) - v * omegaIntegral(w0));
+
+		return std::copysign(G, u);
+	}
+
+	static bool isClose(double a, double b)
+	{
+		return std::abs(a - b) <= relativeTolerance * (std::abs(a) + std::abs(b)) + absoluteTolerance;
+	}
+
+	// The derivative of the antiderivative between a and b, falling back to
+	// the midpoint when they are too close to divide
+	double firstOrder(double a, double b, double Fa, double Fb) const
+	{
+		return isClose(a, b) ? diodeVoltage(0.5 * (a + b)) : (Fa - Fb) / (a - b);
+	}
+
+	double secondOrderDifference(double a, double b, double Fa, double Fb) const
+	{
+		return isClose(a, b) ? diodeVoltageIntegral(0.5 * (a + b)) : (Fa - Fb) / (a - b);
+	}
+
+	// Bilbao et al. eq. 20, and eq. 23 when u0 and u2 are close
+	double secondOrder(double u0, double u1, double u2, double F0, double F1, double F2) const
+	{
+		if (! isClose(u0, u2))
+			return 2.0 / (u0 - u2) * (secondOrderDifference(u0, u1, F0, F1) - secondOrderDifference(u1, u2, F1, F2));
+
+		const double mean = 0.5 * (u0 + u2);
+
+		if (isClose(mean, u1))
+			return diodeVoltage(0.5 * (mean + u1));
+
+		const double delta = mean - u1;
+		return 2.0 / delta * (diodeVoltageIntegral(mean) + (F1 - diodeVoltageSecondIntegral(mean)) / delta);
+	}
+
+	SampleType processSingleSample(SampleType Vin, size_t channel)
+	{
+		auto& state = states[channel];
+
+		const double x = Vin;
+		const double u = b0 * (x - state.x1) - a1 * state.u1;
+
+		// The linear Vin term goes through the same averaging, which reduces
+		// to these FIR filters
+		double Vout;
+
+		if constexpr (Order == 1)
+		{
+			const double F = diodeVoltageIntegral(u);
+			Vout = 0.5 * (x + state.x1) + firstOrder(u, state.u1, F, state.F1);
+
+			state.F1 = F;
+		}
+		else
+		{
+			const double F = diodeVoltageSecondIntegral(u);
+			Vout = (x + state.x1 + state.x2) / 3.0 + secondOrder(u, state.u1, state.u2, F, state.F1, state.F2);
+
+			state.F2 = state.F1;
+			state.F1 = F;
+		}
+
+		state.x2 = state.x1;
+		state.x1 = x;
+		state.u2 = state.u1;
+		state.u1 = u;
+
+		return (SampleType) Vout;
+	}
+
+	// Bilinear transform of the high-pass s R4 C1 / (1 + s R4 C1)
+	void updateCoefficients()
+	{
+		const double K = 2.0 * R4 * C1 / (double) Ts;
+
+		b0 = K / (1.0 + K);
+		a1 = (1.0 - K) / (1.0 + K);
+	}
+
+	//==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ADAAClipper)
+};
@@ -1,31 +1,159 @@
 #pragma once
 
+#include "DiodeModel.h"
+#include "SolverStats.h"
+
+// Per-sample gains applied to a circuit's input and output inside its loop,
+// so the gain stages around it don't need passes of their own. nullptr is
+// unity.
+template <typename SampleType>
+struct ClipperGains
+{
+	const SampleType* pre = nullptr;
+	const SampleType* post = nullptr;
+
+	SampleType applyPre(SampleType Vin, size_t i) const   { return pre  != nullptr ? Vin  * pre[i]  : Vin; }
+	SampleType applyPost(SampleType Vout, size_t i) const { return post != nullptr ? Vout * post[i] : Vout; }
+
+	// The gains from sample start on
+	ClipperGains from(size_t start) const
+	{
+		return { pre != nullptr ? pre + start : nullptr, post != nullptr ? post + start : nullptr };
+	}
+};
+
+// Circuits derive from ClipperBase<Circuit, SampleType> and provide
+// processSingleSample, updateCoefficients and optionally processLanes. The
+// calls are resolved at compile time so the per-sample solver can be inlined
+// into process(). SampleType is float or double, the type of the blocks the
+// circuit processes and of its states and coefficients.
+//
+// Circuits whose components can change while running record the changes
+// and apply them in applyPendingChanges(numSamples), which process() calls
+// with the samples left in the block. It returns how many of them the
+// coefficients it leaves hold for, so a circuit gliding between values can
+// step them every few samples and otherwise runs the whole block on one set.
+//
+// For the silence gate, circuits also provide isQuiescent(tolerance), true
+// once every channel's state is within tolerance volts of rest, clearState()
+// and getTimeConstant(), the slowest decay of the circuit at rest in seconds.
+template <typename Derived, typename Sample>
 class ClipperBase
 {
 public:
 	ClipperBase() {}
 	~ClipperBase() {}
 
+	using SampleType = Sample;
+	using Gains = ClipperGains<SampleType>;
+
+	// Each channel keeps its own circuit state. 12 channels covers 7.1.4 and
+	// is a whole number of SIMD registers, so the vector path can load the
+	// states lane by lane.
+	static constexpr size_t maxChannels = 12;
+
+   #if JUCE_USE_SIMD
+	static_assert (maxChannels % SIMDMath::Vec::SIMDNumElements == 0, "States must fill whole SIMD registers");
+   #endif
+
 	void reset (float Fs)
 	{
-		Ts = 1.f / Fs;
-		updateCoefficients();
+		Ts = (SampleType) 1 / (SampleType) Fs;
+		samplePeriod = 1.0 / (double) Fs;
+		derived().updateCoefficients();
+	}
+
+	SampleType processSample(SampleType Vin, size_t channel = 0)
+	{
+		return derived().processSingleSample(Vin, channel);
+	}
+
+	// Caps the solver's iterations per sample. Circuits that iterate hide
+	// this; the others have nothing to cap.
+	static constexpr uint32_t defaultMaxIterations = 50;
+
+	void setMaxIterations(uint32_t) {}
+
+	// Iteration counts gathered while SYN_SOLVER_STATS is enabled, likewise
+	// only kept by the circuits that iterate
+	const SolverStats& getSolverStats() const
+	{
+		static const SolverStats none;
+		return none;
 	}
 
+	void resetSolverStats() {}
+
+	// Called from prepare with every sample rate the circuit may be reset()
+	// to on the audio thread, so expensive data for them can be fetched up
+	// front. Most circuits have none.
+	void prepareSampleRates(const std::vector<float>&) {}
+
+	// Delay of the output in samples at the circuit's rate, for circuits
+	// that filter it. Most have none.
+	float getLatency() const { return 0.f; }
+
+	size_t applyPendingChanges(size_t numSamples) { return numSamples; }
+
 	template <typename Context>
-    void process (Context& context)
+    void process (Context& context, const Gains& gains = {})
     {
     	auto&& inputBlock  = context.getInputBlock();
     	auto&& outputBlock = context.getOutputBlock();
     	auto numSamples  = inputBlock.getNumSamples();
     	auto numChannels = inputBlock.getNumChannels();
 
-    	for (size_t channel = 0; channel < numChannels; ++channel)
+    	jassert (numChannels <= maxChannels);
+    	numChannels = juce::jmin(numChannels, maxChannels);
+
+    	for (size_t start = 0; start < numSamples;)
     	{
-    		auto* src = inputBlock .getChannelPointer (channel);
-    		auto* dst = outputBlock.getChannelPointer (channel);
+    		const auto length = juce::jmin(derived().applyPendingChanges(numSamples - start), numSamples - start);
 
-    		if (context.isBypassed)
+    		processRange(inputBlock, outputBlock, numChannels, start, length, context.isBypassed, gains.from(start));
+    		start += length;
+    	}
+    }
+
+    // Samples start to start + numSamples of the block, on the current coefficients
+    template <typename InputBlock, typename OutputBlock>
+    void processRange(const InputBlock& inputBlock, const OutputBlock& outputBlock, size_t numChannels, size_t start,
+                      size_t numSamples, bool isBypassed, const Gains& gains)
+    {
+    	size_t channel = 0;
+
+       #if JUCE_USE_SIMD
+    	// The lanes are float registers, so double blocks run channel by channel
+    	if constexpr (std::is_same_v<SampleType, float>)
+    	{
+    		constexpr auto lanes = SIMDMath::Vec::size();
+
+    		if (! isBypassed && numChannels > 1)
+    		{
+    			for (; channel < numChannels; channel += lanes)
+    			{
+    				const float* src[lanes] = {};
+    				float* dst[lanes] = {};
+    				const auto numLanes = juce::jmin(lanes, numChannels - channel);
+
+    				for (size_t lane = 0; lane < numLanes; ++lane)
+    				{
+    					src[lane] = inputBlock .getChannelPointer (channel + lane) + start;
+    					dst[lane] = outputBlock.getChannelPointer (channel + lane) + start;
+    				}
+
+    				derived().processLanes(src, dst, channel, numLanes, numSamples, gains);
+    			}
+    		}
+    	}
+       #endif
+
+    	for (; channel < numChannels; ++channel)
+    	{
+    		auto* src = inputBlock .getChannelPointer (channel) + start;
+    		auto* dst = outputBlock.getChannelPointer (channel) + start;
+
+    		if (isBypassed)
     		{
     			for (size_t i = 0; i < numSamples; ++i)
     			{
@@ -36,44 +164,56 @@ public:
     		{
     			for (size_t i = 0; i < numSamples; ++i)
     			{
-    				dst[i] = processSingleSample(src[i]);
+    				dst[i] = gains.applyPost(derived().processSingleSample(gains.applyPre(src[i], i), channel), i);
     			}
     		}
     	}
     }
 
-    float getCapResistance(float C)
+    // In the circuit's sample type, or in double for solvers that run in
+    // double on float blocks
+    template <typename T>
+    T getCapResistance(T C) const
     {
-    	return Ts / (2.f * C);
+    	if constexpr (std::is_same_v<T, SampleType>)
+    		return Ts / ((T) 2 * C);
+    	else
+    		return (T) samplePeriod / ((T) 2 * C);
     }
 
-    static float symmetricDiodes(float Vin, bool isDenom = false, float n = 1.f)
+    // symmetricDiodes, and positiveDiode + negativeDiode, as shared kernels
+    static constexpr DiodePair symmetricDiodePair { (float) 1e-15, 1.f };
+    static constexpr DiodePair clippingDiodePair { (float) 10e-12, 1.2f };
+
+    template <typename T>
+    static T symmetricDiodes(T Vin, bool isDenom = false, T n = 1)
 	{
-		const float eta = 1.f;
-		const float Is = (float) 1e-15;
-		const float Vt = (float) 26e-3;
+		const T eta = (T) 1;
+		const T Is = (T) 1e-15;
+		const T Vt = (T) 26e-3;
 
-		float Vd = 0.f;
+		T Vd = 0;
 
 		if (isDenom)
     	{
-    		Vd = 2.f * Is / (n * eta * Vt) * cosh(Vin / (n * eta * Vt));
+    		Vd = (T) 2 * Is / (n * eta * Vt) * cosh(Vin / (n * eta * Vt));
     	}
     	else
     	{
-    		Vd = 2.f * Is * sinh(Vin / (n * eta * Vt));
+    		Vd = (T) 2 * Is * sinh(Vin / (n * eta * Vt));
     	}
 
     	return Vd;
 	}
 
-	static float positiveDiode(float Vin, bool isDenom = false, float n = 1.f)
+	template <typename T>
+	static T positiveDiode(T Vin, bool isDenom = false, T n = 1)
     {
-    	const float eta = 1.2f;
-    	const float Is = (float) 10e-12;
-    	const float Vt = (float) 26e-3;
+    	const T eta = (T) 1.2;
+    	const T Is = (T) 10e-12;
+    	const T Vt = (T) 26e-3;
 
-    	float Vd = 0.f;
+    	T Vd = 0;
 
     	if (isDenom)
     	{
@@ -87,13 +227,14 @@ public:
     	return Vd;
     }
 
-    static float negativeDiode(float Vin, bool isDenom = false, float n = 1.f)
+    template <typename T>
+    static T negativeDiode(T Vin, bool isDenom = false, T n = 1)
     {
-    	const float eta = 1.2f;
-    	const float Is = (float) 10e-12;
-    	const float Vt = (float) 26e-3;
+    	const T eta = (T) 1.2;
+    	const T Is = (T) 10e-12;
+    	const T Vt = (T) 26e-3;
 
-    	float Vd = 0.f;
+    	T Vd = 0;
 
     	if (isDenom)
     	{
@@ -107,15 +248,35 @@ public:
     	return Vd;
     }
 
-private:
-	float Ts = 1.f / 44100.0f;
+protected:
+	SampleType Ts = (SampleType) 1 / (SampleType) 44100;
+	double samplePeriod = 1.0 / 44100.0;
 
-	virtual float processSingleSample(float Vin)
+	Derived& derived() { return static_cast<Derived&>(*this); }
+
+	SampleType processSingleSample(SampleType Vin, size_t channel)
 	{
-		float Vout = Vin;
+		juce::ignoreUnused(channel);
+
+		SampleType Vout = Vin;
 
 		return Vout;
 	}
 
-	virtual void updateCoefficients() {}
+	// Processes numLanes adjacent channels starting at firstChannel. Circuits
+	// with a vectorised solver provide their own to run the lanes in lockstep.
+	// Only float blocks run in lanes.
+	void processLanes(const SampleType* const* src, SampleType* const* dst, size_t firstChannel, size_t numLanes, size_t numSamples,
+	                  const Gains& gains)
+	{
+		for (size_t lane = 0; lane < numLanes; ++lane)
+		{
+			for (size_t i = 0; i < numSamples; ++i)
+			{
+				dst[lane][i] = gains.applyPost(derived().processSingleSample(gains.applyPre(src[lane][i], i), firstChannel + lane), i);
+			}
+		}
+	}
+
+	void updateCoefficients() {}
 };
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "ClipperBase.h"
+
+// Holds one instance of every circuit and switches between them at runtime.
+// The active circuit is looked up once per block, after which the block runs
+// through that circuit's statically dispatched process(). The circuits all
+// process the same SampleType.
+template <typename... Clippers>
+class ClipperSelector
+{
+public:
+	ClipperSelector() {}
+	~ClipperSelector() {}
+
+	static constexpr size_t numClippers = sizeof...(Clippers);
+
+	using SampleType = typename std::tuple_element_t<0, std::tuple<Clippers...>>::SampleType;
+	using Gains = ClipperGains<SampleType>;
+
+	static_assert ((std::is_same_v<typename Clippers::SampleType, SampleType> && ...), "Every circuit must process the same sample type");
+
+	void reset(float Fs)
+	{
+		forEach([Fs](auto& clipper) { clipper.reset(Fs); });
+	}
+
+	void prepareSampleRates(const std::vector<float>& sampleRates)
+	{
+		forEach([&sampleRates](auto& clipper) { clipper.prepareSampleRates(sampleRates); });
+	}
+
+	// The incoming circuit starts from rest rather than from whatever it
+	// held when it was last switched away from
+	void setIndex(size_t newIndex)
+	{
+		jassert (newIndex < numClippers);
+		newIndex = juce::jmin(newIndex, numClippers - 1);
+
+		if (newIndex != index)
+			visit(newIndex, [](auto& clipper) { clipper.clearState(); });
+
+		index = newIndex;
+	}
+
+	size_t getIndex() const { return index; }
+
+	template <typename Clipper>
+	Clipper& get() { return std::get<Clipper>(clippers); }
+
+	template <typename Context>
+	void process(Context& context, const Gains& gains = {})
+	{
+		visit(index, [&context, &gains](auto& clipper) { clipper.process(context, gains); });
+	}
+
+	// The silence gate's queries. Quiescence is that of the active circuit,
+	// the time constant the slowest of all, since hosts may cache the tail.
+	bool isQuiescent(float tolerance)
+	{
+		bool quiescent = true;
+		visit(index, [&quiescent, tolerance](auto& clipper) { quiescent = clipper.isQuiescent(tolerance); });
+		return quiescent;
+	}
+
+	void clearState()
+	{
+		forEach([](auto& clipper) { clipper.clearState(); });
+	}
+
+	float getTimeConstant()
+	{
+		float timeConstant = 0.f;
+		forEach([&timeConstant](auto& clipper) { timeConstant = juce::jmax(timeConstant, clipper.getTimeConstant()); });
+		return timeConstant;
+	}
+
+	// The active circuit's solver counters, for the metrics
+	const SolverStats& getSolverStats()
+	{
+		const SolverStats* stats = nullptr;
+		visit(index, [&stats](auto& clipper) { stats = &clipper.getSolverStats(); });
+		return *stats;
+	}
+
+	void resetSolverStats()
+	{
+		visit(index, [](auto& clipper) { clipper.resetSolverStats(); });
+	}
+
+	// The active circuit's delay, in samples at its rate
+	float getLatency()
+	{
+		float latency = 0.f;
+		visit(index, [&latency](auto& clipper) { latency = clipper.getLatency(); });
+		return latency;
+	}
+
+	template <typename Fn>
+	void forEach(Fn&& fn)
+	{
+		std::apply([&fn](auto&... clipper) { (fn(clipper), ...); }, clippers);
+	}
+
+private:
+	std::tuple<Clippers...> clippers;
+	size_t index = 0;
+
+	template <typename Fn, size_t... Is>
+	void visit(size_t i, Fn&& fn, std::index_sequence<Is...>)
+	{
+		((i == Is ? fn(std::get<Is>(clippers)) : void()), ...);
+	}
+
+	template <typename Fn>
+	void visit(size_t i, Fn&& fn)
+	{
+		visit(i, std::forward<Fn>(fn), std::index_sequence_for<Clippers...>{});
+	}
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClipperSelector)
+};
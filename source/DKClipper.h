@@ -0,0 +1,273 @@
+#pragma once
+
+#include "ClipperBase.h"
+#include "DKMethod.h"
+
+// Runs any netlist through the DK-method. The matrices are rebuilt on reset()
+// and when a component value changes, and each sample solves for the diode
+// voltages with damped Newton-Raphson on numNonlinear unknowns, warm started
+// from the previous sample.
+template <typename Netlist, typename SampleType>
+class DKClipper : public ClipperBase<DKClipper<Netlist, SampleType>, SampleType>
+{
+public:
+	DKClipper() {}
+	~DKClipper() {}
+
+	using Model = DK::Model<Netlist, SampleType>;
+
+	static constexpr size_t numStates = Model::numStates;
+	static constexpr size_t numNonlinear = Model::numNonlinear;
+
+	// Changes the value of the index-th component in the netlist and rebuilds
+	// the matrices. Allocation free, but not cheap enough to call per sample.
+	void setComponentValue(size_t index, float newValue)
+	{
+		jassert (index < components.size());
+
+		if (components[index].value == newValue)
+			return;
+
+		components[index].value = newValue;
+		updateCoefficients();
+	}
+
+	float getComponentValue(size_t index) const { return components[index].value; }
+
+	void setMaxIterations(uint32_t newMaxIterations) { maxIterations = juce::jmax((uint32_t) 1, newMaxIterations); }
+
+	bool isQuiescent(float tolerance) const
+	{
+		for (size_t channel = 0; channel < Base::maxChannels; ++channel)
+		{
+			for (size_t k = 0; k < numStates; ++k)
+				if (std::abs(X[channel][k] * model.stateToVoltage[k]) > (SampleType) tolerance)
+					return false;
+
+			for (size_t k = 0; k < numNonlinear; ++k)
+				if (std::abs(V[channel][k]) > (SampleType) tolerance)
+					return false;
+		}
+
+		return true;
+	}
+
+	void clearState()
+	{
+		for (auto& x : X)
+			x.fill((SampleType) 0);
+
+		for (auto& v : V)
+			v.fill((SampleType) 0);
+	}
+
+	float getTimeConstant() const { return model.timeConstant; }
+
+	// Iteration counts gathered while SYN_SOLVER_STATS is enabled
+	const SolverStats& getSolverStats() const { return stats; }
+	void resetSolverStats() { stats.clear(); }
+
+private:
+	friend class ClipperBase<DKClipper<Netlist, SampleType>, SampleType>;
+	using Base = ClipperBase<DKClipper<Netlist, SampleType>, SampleType>;
+
+	typename Model::Components components = Netlist::components;
+	Model model;
+
+	std::array<std::array<SampleType, numStates>, Base::maxChannels> X {};
+	std::array<std::array<SampleType, numNonlinear>, Base::maxChannels> V {};
+
+	const SampleType stepThr = (SampleType) 0.000001;
+	uint32_t maxIterations = Base::defaultMaxIterations;
+
+	SolverStats stats;
+
+	// Float runs on the fast exponential. Its error is near float's own, but
+	// far above double's, so double uses std::exp.
+	static SampleType exp(SampleType x)
+	{
+		if constexpr (std::is_same_v<SampleType, float>)
+			return DiodeMath::fastExp(x);
+		else
+			return std::exp(x);
+	}
+
+	static void evaluate(const DK::Component& component, SampleType v, SampleType& current, SampleType& conductance)
+	{
+		if (component.type == DK::ComponentType::diodePair)
+		{
+			if constexpr (std::is_same_v<SampleType, float>)
+				component.diodes.template evaluate<DiodePrecision::fast>(v, current, conductance);
+			else
+				component.diodes.evaluate(v, current, conductance);
+		}
+		else
+		{
+			const SampleType Is = (SampleType) component.diodes.Is;
+			const SampleType invNVt = (SampleType) component.diodes.invNVt;
+			const SampleType e = exp(v * invNVt);
+
+			current = Is * (e - (SampleType) 1);
+			conductance = Is * invNVt * e;
+		}
+	}
+
+	// Residual f(v) = p + K i(v) - v for the diode voltages v
+	void residual(const DK::Matrix<SampleType, numNonlinear, 1>& p,
+				  const std::array<SampleType, numNonlinear>& v,
+				  std::array<SampleType, numNonlinear>& current,
+				  std::array<SampleType, numNonlinear>& conductance,
+				  DK::Matrix<SampleType, numNonlinear, 1>& f) const
+	{
+		for (size_t k = 0; k < numNonlinear; ++k)
+			evaluate(*model.nonlinear[k], v[k], current[k], conductance[k]);
+
+		for (size_t r = 0; r < numNonlinear; ++r)
+		{
+			SampleType sum = p(r, 0) - v[r];
+
+			for (size_t k = 0; k < numNonlinear; ++k)
+				sum += model.K(r, k) * current[k];
+
+			f(r, 0) = sum;
+		}
+	}
+
+	static SampleType norm(const DK::Matrix<SampleType, numNonlinear, 1>& f)
+	{
+		SampleType result = (SampleType) 0;
+
+		for (auto value : f.m)
+			result = juce::jmax(result, std::abs(value));
+
+		return result;
+	}
+
+	SampleType processSingleSample(SampleType Vin, size_t channel)
+	{
+		auto& x = X[channel];
+		auto& v = V[channel];
+
+		DK::Matrix<SampleType, numNonlinear, 1> p;
+
+		for (size_t r = 0; r < numNonlinear; ++r)
+		{
+			SampleType sum = model.H(r, 0) * Vin;
+
+			for (size_t k = 0; k < numStates; ++k)
+				sum += model.G(r, k) * x[k];
+
+			p(r, 0) = sum;
+		}
+
+		std::array<SampleType, numNonlinear> current, conductance;
+		DK::Matrix<SampleType, numNonlinear, 1> f;
+		residual(p, v, current, conductance, f);
+
+		SampleType b = (SampleType) 1;
+		uint32_t iter = 0;
+		bool converged = false;
+
+	   #if SYN_SOLVER_STATS
+		uint32_t backtracks = 0;
+	   #endif
+
+		for (; iter < maxIterations; ++iter)
+		{
+			// Newton step from J = K diag(conductance) - I
+			DK::Matrix<SampleType, numNonlinear, numNonlinear> J;
+
+			for (size_t r = 0; r < numNonlinear; ++r)
+			{
+				for (size_t k = 0; k < numNonlinear; ++k)
+					J(r, k) = model.K(r, k) * conductance[k];
+
+				J(r, r) -= (SampleType) 1;
+			}
+
+			auto step = f;
+
+			if (! DK::solve(J, step))
+				break;
+
+			if (norm(step) < stepThr)
+			{
+				for (size_t k = 0; k < numNonlinear; ++k)
+					v[k] -= step(k, 0);
+
+				residual(p, v, current, conductance, f);
+				converged = true;
+				break;
+			}
+
+			std::array<SampleType, numNonlinear> vNew, currentNew, conductanceNew;
+			DK::Matrix<SampleType, numNonlinear, 1> fNew;
+
+			for (size_t k = 0; k < numNonlinear; ++k)
+				vNew[k] = v[k] - b * step(k, 0);
+
+			residual(p, vNew, currentNew, conductanceNew, fNew);
+
+			if (norm(fNew) < norm(f))
+			{
+				v = vNew;
+				current = currentNew;
+				conductance = conductanceNew;
+				f = fNew;
+				b = (SampleType) 1;
+			}
+			else
+			{
+				b *= (SampleType) 0.5;
+
+			   #if SYN_SOLVER_STATS
+				++backtracks;
+			   #endif
+			}
+		}
+
+		// A singular Jacobian ends the solve unconverged, like the cap
+	   #if SYN_SOLVER_STATS
+		stats.add(iter, backtracks, ! converged);
+	   #else
+		juce::ignoreUnused(converged);
+	   #endif
+
+		SampleType y = model.E * Vin;
+
+		for (size_t k = 0; k < numStates; ++k)
+			y += model.D(0, k) * x[k];
+
+		for (size_t k = 0; k < numNonlinear; ++k)
+			y += model.F(0, k) * current[k];
+
+		std::array<SampleType, numStates> xNew;
+
+		for (size_t r = 0; r < numStates; ++r)
+		{
+			SampleType sum = model.B(r, 0) * Vin;
+
+			for (size_t k = 0; k < numStates; ++k)
+				sum += model.A(r, k) * x[k];
+
+			for (size_t k = 0; k < numNonlinear; ++k)
+				sum += model.C(r, k) * current[k];
+
+			xNew[r] = sum;
+		}
+
+		x = xNew;
+		return y;
+	}
+
+	void updateCoefficients()
+	{
+		const bool built = model.build(components, (double) this->Ts);
+
+		jassert (built);
+		juce::ignoreUnused (built);
+	}
+
+	//==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DKClipper)
+};
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "DiodeModel.h"
+
+// Netlists compiled into nodal DK-method state-space matrices (Yeh, "Automated
+// Physical Modeling of Nonlinear Audio Circuits for Real-Time Audio Effects",
+// 2010). The netlist is data: a node count, an output node and a list of
+// components. Capacitors become trapezoidal rule states and the diodes become
+// the nonlinear ports, so each sample reduces to
+//
+//     v = G x + H u + K i(v)          (solved for the diode voltages v)
+//     y = D x + E u + F i(v)
+//     x = A x + B u + C i(v)
+//
+// All sizes are known at compile time. The matrices are built in double
+// precision by Model::build(), and only when the sample rate or a component
+// value changes, then stored in the sample type the circuit runs in.
+namespace DK
+{
+	enum class ComponentType
+	{
+		resistor,
+		capacitor,
+		inputSource,
+		opAmp,
+		diode,
+		diodePair
+	};
+
+	// Node 0 is ground. An opAmp's nodes are { +, -, out }, and a diode
+	// conducts from its first node to its second.
+	struct Component
+	{
+		ComponentType type;
+		std::array<size_t, 3> nodes;
+		float value;
+		DiodePair diodes;
+	};
+
+	constexpr Component resistor(size_t a, size_t b, float resistance)
+	{
+		return { ComponentType::resistor, { a, b, 0 }, resistance, DiodePair(0.f, 1.f) };
+	}
+
+	constexpr Component capacitor(size_t a, size_t b, float capacitance)
+	{
+		return { ComponentType::capacitor, { a, b, 0 }, capacitance, DiodePair(0.f, 1.f) };
+	}
+
+	// The circuit's input, an ideal voltage source from b to a
+	constexpr Component inputSource(size_t a, size_t b)
+	{
+		return { ComponentType::inputSource, { a, b, 0 }, 0.f, DiodePair(0.f, 1.f) };
+	}
+
+	// Ideal op-amp (a nullor): both inputs at the same voltage, no input
+	// current, and whatever output current that takes
+	constexpr Component opAmp(size_t plus, size_t minus, size_t out)
+	{
+		return { ComponentType::opAmp, { plus, minus, out }, 0.f, DiodePair(0.f, 1.f) };
+	}
+
+	constexpr Component diode(size_t anode, size_t cathode, DiodePair model)
+	{
+		return { ComponentType::diode, { anode, cathode, 0 }, 0.f, model };
+	}
+
+	constexpr Component diodePair(size_t a, size_t b, DiodePair model)
+	{
+		return { ComponentType::diodePair, { a, b, 0 }, 0.f, model };
+	}
+
+	template <size_t N>
+	constexpr size_t count(const std::array<Component, N>& components, ComponentType type)
+	{
+		size_t n = 0;
+
+		for (const auto& component : components)
+			if (component.type == type)
+				++n;
+
+		return n;
+	}
+
+	//==============================================================================
+	template <typename T, size_t Rows, size_t Cols>
+	struct Matrix
+	{
+		std::array<T, Rows * Cols> m {};
+
+		T& operator()(size_t row, size_t col) { return *(m.data() + row * Cols + col); }
+		T operator()(size_t row, size_t col) const { return *(m.data() + row * Cols + col); }
+
+		template <typename Other>
+		Matrix<Other, Rows, Cols> cast() const
+		{
+			Matrix<Other, Rows, Cols> result;
+
+			for (size_t i = 0; i < m.size(); ++i)
+				result.m[i] = (Other) m[i];
+
+			return result;
+		}
+	};
+
+	template <typename T, size_t Rows, size_t Inner, size_t Cols>
+	Matrix<T, Rows, Cols> multiply(const Matrix<T, Rows, Inner>& a, const Matrix<T, Inner, Cols>& b)
+	{
+		Matrix<T, Rows, Cols> result;
+
+		for (size_t r = 0; r < Rows; ++r)
+			for (size_t c = 0; c < Cols; ++c)
+				for (size_t k = 0; k < Inner; ++k)
+					result(r, c) += a(r, k) * b(k, c);
+
+		return result;
+	}
+
+	template <typename T, size_t Rows, size_t Cols>
+	Matrix<T, Cols, Rows> transpose(const Matrix<T, Rows, Cols>& a)
+	{
+		Matrix<T, Cols, Rows> result;
+
+		for (size_t r = 0; r < Rows; ++r)
+			for (size_t c = 0; c < Cols; ++c)
+				result(c, r) = a(r, c);
+
+		return result;
+	}
+
+	// Solves a x = b in place by Gaussian elimination with partial pivoting.
+	// b holds x on return. Returns false if a is singular.
+	template <typename T, size_t N, size_t Cols>
+	bool solve(Matrix<T, N, N>& a, Matrix<T, N, Cols>& b)
+	{
+		for (size_t col = 0; col < N; ++col)
+		{
+			size_t pivot = col;
+
+			for (size_t row = col + 1; row < N; ++row)
+				if (std::abs(a(row, col)) > std::abs(a(pivot, col)))
+					pivot = row;
+
+			if (a(pivot, col) == (T) 0)
+				return false;
+
+			if (pivot != col)
+			{
+				for (size_t c = 0; c < N; ++c)
+					std::swap(a(col, c), a(pivot, c));
+
+				for (size_t c = 0; c < Cols; ++c)
+					std::swap(b(col, c), b(pivot, c));
+			}
+
+			for (size_t row = col + 1; row < N; ++row)
+			{
+				const T factor = a(row, col) / a(col, col);
+
+				for (size_t c = col; c < N; ++c)
+					a(row, c) -= factor * a(col, c);
+
+				for (size_t c = 0; c < Cols; ++c)
+					b(row, c) -= factor * b(col, c);
+			}
+		}
+
+		for (size_t row = N; row-- > 0;)
+		{
+			for (size_t c = 0; c < Cols; ++c)
+			{
+				T sum = b(row, c);
+
+				for (size_t k = row + 1; k < N; ++k)
+					sum -= a(row, k) * b(k, c);
+
+				b(row, c) = sum / a(row, row);
+			}
+		}
+
+		return true;
+	}
+
+	//==============================================================================
+	// A netlist provides numNodes, outputNode and a constexpr std::array of
+	// Components named components, with exactly one inputSource. T is the
+	// type of the matrices.
+	template <typename Netlist, typename T>
+	struct Model
+	{
+		static constexpr auto numComponents = Netlist::components.size();
+		static constexpr size_t numStates = count(Netlist::components, ComponentType::capacitor);
+		static constexpr size_t numNonlinear = count(Netlist::components, ComponentType::diode)
+											 + count(Netlist::components, ComponentType::diodePair);
+		static constexpr size_t numUnknowns = Netlist::numNodes
+											+ count(Netlist::components, ComponentType::inputSource)
+											+ count(Netlist::components, ComponentType::opAmp);
+
+		static_assert (count(Netlist::components, ComponentType::inputSource) == 1, "A netlist needs exactly one input");
+		static_assert (Netlist::outputNode > 0 && Netlist::outputNode <= Netlist::numNodes, "The output must be a node other than ground");
+
+		using Components = std::array<Component, numComponents>;
+
+		Matrix<T, numStates, numStates> A;
+		Matrix<T, numStates, 1> B;
+		Matrix<T, numStates, numNonlinear> C;
+		Matrix<T, 1, numStates> D;
+		T E = (T) 0;
+		Matrix<T, 1, numNonlinear> F;
+		Matrix<T, numNonlinear, numStates> G;
+		Matrix<T, numNonlinear, 1> H;
+		Matrix<T, numNonlinear, numNonlinear> K;
+
+		// Each nonlinear port's component, in netlist order. Points into the
+		// array passed to build().
+		std::array<const Component*, numNonlinear> nonlinear {};
+
+		// At rest a state is Gc times its capacitor's voltage
+		std::array<T, numStates> stateToVoltage {};
+
+		// Slowest decay of the circuit with the diodes off, in seconds
+		float timeConstant = 0.f;
+
+		// Ceiling on timeConstant. The clippers decay in well under a
+		// millisecond; a pole near the unit circle, e.g. from a capacitor
+		// with no discharge path, would otherwise report a tail of hours.
+		static constexpr double maxTimeConstant = 0.1;
+
+		// Returns false, leaving the matrices untouched, if the circuit has no
+		// unique solution, e.g. a floating node
+		bool build(const Components& components, double Ts)
+		{
+			Matrix<double, numUnknowns, numUnknowns> S;
+			Matrix<double, numStates, numUnknowns> Nx;
+			Matrix<double, numNonlinear, numUnknowns> Nn;
+			Matrix<double, 1, numUnknowns> Nu, No;
+			std::array<double, numStates> Gc {};
+
+			auto stamp = [&S](size_t a, size_t b, double g)
+			{
+				if (a > 0) S(a - 1, a - 1) += g;
+				if (b > 0) S(b - 1, b - 1) += g;
+
+				if (a > 0 && b > 0)
+				{
+					S(a - 1, b - 1) -= g;
+					S(b - 1, a - 1) -= g;
+				}
+			};
+
+			size_t state = 0, port = 0, extra = Netlist::numNodes;
+
+			for (const auto& component : components)
+			{
+				const auto a = component.nodes[0];
+				const auto b = component.nodes[1];
+
+				switch (component.type)
+				{
+					case ComponentType::resistor:
+						stamp(a, b, 1.0 / (double) component.value);
+						break;
+
+					case ComponentType::capacitor:
+						Gc[state] = 2.0 * (double) component.value / Ts;
+						stamp(a, b, Gc[state]);
+						incidence(Nx, state++, a, b);
+						break;
+
+					case ComponentType::inputSource:
+					{
+						const auto row = extra++;
+
+						if (a > 0) { S(a - 1, row) += 1.0; S(row, a - 1) += 1.0; }
+						if (b > 0) { S(b - 1, row) -= 1.0; S(row, b - 1) -= 1.0; }
+
+						Nu(0, row) = 1.0;
+						break;
+					}
+
+					case ComponentType::opAmp:
+					{
+						const auto row = extra++;
+						const auto out = component.nodes[2];
+
+						if (out > 0) S(out - 1, row) += 1.0;
+						if (a > 0)   S(row, a - 1) += 1.0;
+						if (b > 0)   S(row, b - 1) -= 1.0;
+						break;
+					}
+
+					case ComponentType::diode:
+					case ComponentType::diodePair:
+						nonlinear[port] = &component;
+						incidence(Nn, port++, a, b);
+						break;
+				}
+			}
+
+			incidence(No, 0, Netlist::outputNode, 0);
+
+			// Every product below has S^-1 on the right of an incidence matrix,
+			// so S is solved against the transposed incidences once
+			auto SiNx = transpose(Nx);
+			auto SiNn = transpose(Nn);
+			auto SiNu = transpose(Nu);
+
+			{
+				auto lu = S;
+				if (! solve(lu, SiNx)) return false;
+				lu = S;
+				if (! solve(lu, SiNn)) return false;
+				lu = S;
+				if (! solve(lu, SiNu)) return false;
+			}
+
+			// Capacitor currents are i = Gc v - x, and their states update as
+			// x = 2 Gc v - x. Diode currents leave the first node, so they
+			// enter the system negated.
+			auto scaledNx = Nx;
+
+			for (size_t r = 0; r < numStates; ++r)
+				for (size_t c = 0; c < numUnknowns; ++c)
+					scaledNx(r, c) *= 2.0 * Gc[r];
+
+			auto Ad = multiply(scaledNx, SiNx);
+
+			for (size_t r = 0; r < numStates; ++r)
+				Ad(r, r) -= 1.0;
+
+			for (size_t r = 0; r < numStates; ++r)
+				stateToVoltage[r] = (T) (1.0 / Gc[r]);
+
+			const auto decay = Ts / -std::log(juce::jlimit(1e-12, 1.0 - 1e-12, spectralRadius(Ad)));
+			jassert(decay <= maxTimeConstant);
+			timeConstant = (float) juce::jmin(decay, maxTimeConstant);
+
+			A = Ad.template cast<T>();
+			B = multiply(scaledNx, SiNu).template cast<T>();
+			C = negate(multiply(scaledNx, SiNn)).template cast<T>();
+			D = multiply(No, SiNx).template cast<T>();
+			E = (T) multiply(No, SiNu)(0, 0);
+			F = negate(multiply(No, SiNn)).template cast<T>();
+			G = multiply(Nn, SiNx).template cast<T>();
+			H = multiply(Nn, SiNu).template cast<T>();
+			K = negate(multiply(Nn, SiNn)).template cast<T>();
+
+			return true;
+		}
+
+	private:
+		template <size_t Rows, size_t Cols>
+		static void incidence(Matrix<double, Rows, Cols>& matrix, size_t row, size_t a, size_t b)
+		{
+			if (a > 0) matrix(row, a - 1) += 1.0;
+			if (b > 0) matrix(row, b - 1) -= 1.0;
+		}
+
+		// ||A^k||^(1/k) for k = 1024, by repeated squaring
+		static double spectralRadius(Matrix<double, numStates, numStates> power)
+		{
+			double logScale = 0.0;
+
+			for (int i = 0; i < 10; ++i)
+			{
+				power = multiply(power, power);
+				logScale *= 2.0;
+
+				double norm = 0.0;
+
+				for (auto value : power.m)
+					norm = juce::jmax(norm, std::abs(value));
+
+				if (norm == 0.0)
+					return 0.0;
+
+				for (auto& value : power.m)
+					value /= norm;
+
+				logScale += std::log(norm);
+			}
+
+			return std::exp(logScale / 1024.0);
+		}
+
+		template <size_t Rows, size_t Cols>
+		static Matrix<double, Rows, Cols> negate(Matrix<double, Rows, Cols> matrix)
+		{
+			for (auto& value : matrix.m)
+				value = -value;
+
+			return matrix;
+		}
+	};
+}
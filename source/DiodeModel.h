@@ -0,0 +1,106 @@
+#pragma once
+
+#include "SIMDMath.h"
+
+// How the diode exponential is evaluated.
+//  - exact: std::exp, within 1 ulp
+//  - fast:  range reduction and a degree 6 polynomial, relative error below
+//           3e-7 (2.4e-7 measured over [-80, 80]). For a pair with
+//           nVt = 31.2 mV this moves the solved voltage by less than 10 nV.
+//  - simd:  the same polynomial on SIMDRegister lanes, so several channels
+//           are evaluated by one call. Scalar calls fall back to fast.
+enum class DiodePrecision
+{
+	exact,
+	fast,
+	simd
+};
+
+namespace DiodeMath
+{
+	inline float fastExp(float x)
+	{
+		const float magic = 12582912.f;
+
+		x = juce::jlimit(-87.f, 88.f, x);
+
+		const float rounded = x * 1.44269504f + magic;
+		const float r = rounded - magic;
+		const float f = x - r * 0.693145752f - r * 1.42860677e-6f;
+
+		float poly = 1.f / 720.f;
+		poly = poly * f + 1.f / 120.f;
+		poly = poly * f + 1.f / 24.f;
+		poly = poly * f + 1.f / 6.f;
+		poly = poly * f + 0.5f;
+		poly = poly * f + 1.f;
+		poly = poly * f + 1.f;
+
+		// Bit pattern of magic, so the difference is round(x / ln2)
+		const uint32_t magicBits = 0x4b400000u;
+
+		uint32_t roundedBits, polyBits;
+		std::memcpy(&roundedBits, &rounded, sizeof(float));
+		std::memcpy(&polyBits, &poly, sizeof(float));
+
+		polyBits += (roundedBits - magicBits) << 23;
+		std::memcpy(&poly, &polyBits, sizeof(float));
+
+		return poly;
+	}
+
+	template <DiodePrecision precision>
+	inline float exp(float x)
+	{
+		if constexpr (precision == DiodePrecision::exact)
+			return std::exp(x);
+		else
+			return fastExp(x);
+	}
+}
+
+// Two identical diodes in anti-parallel, i = Is * (e^(V/nVt) - e^(-V/nVt)).
+// The current and its derivative share one exponential and one reciprocal,
+// where positiveDiode + negativeDiode needed four exponentials for both.
+struct DiodePair
+{
+	constexpr DiodePair(float saturationCurrent, float ideality, float thermalVoltage = (float) 26e-3)
+		: Is(saturationCurrent),
+		  invNVt(1.f / (ideality * thermalVoltage))
+	{}
+
+	template <DiodePrecision precision>
+	void evaluate(float V, float& current, float& conductance) const
+	{
+		const float e = DiodeMath::exp<precision>(V * invNVt);
+		const float eInv = 1.f / e;
+
+		current = Is * (e - eInv);
+		conductance = Is * invNVt * (e + eInv);
+	}
+
+	// For solvers running in double. The polynomial is only accurate to
+	// float precision, so this is always std::exp.
+	void evaluate(double V, double& current, double& conductance) const
+	{
+		const double e = std::exp(V * (double) invNVt);
+		const double eInv = 1.0 / e;
+
+		current = (double) Is * (e - eInv);
+		conductance = (double) Is * (double) invNVt * (e + eInv);
+	}
+
+   #if JUCE_USE_SIMD
+	void evaluate(SIMDMath::Vec V, SIMDMath::Vec& current, SIMDMath::Vec& conductance) const
+	{
+		const auto e = SIMDMath::exp(V * invNVt);
+		const auto eInv = SIMDMath::divide(SIMDMath::Vec::expand(1.f), e);
+
+		current = (e - eInv) * Is;
+		conductance = (e + eInv) * (Is * invNVt);
+	}
+   #endif
+
+	float Is;
+	float invNVt;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "SolverStats.h"
+#include "QualityGovernor.h"
+
+// Per-block solver and CPU load metrics, handed from the audio thread to the
+// message thread without locks. Only compiled in when SYN_SOLVER_STATS is 1.
+#if SYN_SOLVER_STATS
+
+struct BlockMetrics
+{
+	uint32_t numSamples = 0;
+	uint32_t solves = 0;
+	uint32_t iterations = 0;
+	uint32_t maxIterations = 0;
+	uint32_t capHits = 0;
+	float load = 0.f;
+	uint32_t qualityLevel = 0;
+};
+
+// Single producer, single consumer. push() is wait-free and drops the block's
+// metrics if the consumer has fallen behind.
+class MetricsFifo
+{
+public:
+	MetricsFifo() {}
+	~MetricsFifo() {}
+
+	void push(const BlockMetrics& metrics)
+	{
+		const auto scope = fifo.write(1);
+
+		if (scope.blockSize1 > 0)
+			buffer[(size_t) scope.startIndex1] = metrics;
+	}
+
+	template <typename Fn>
+	void popAll(Fn&& fn)
+	{
+		const auto scope = fifo.read(fifo.getNumReady());
+
+		for (int i = 0; i < scope.blockSize1; ++i)
+			fn(buffer[(size_t) (scope.startIndex1 + i)]);
+
+		for (int i = 0; i < scope.blockSize2; ++i)
+			fn(buffer[(size_t) (scope.startIndex2 + i)]);
+	}
+
+private:
+	static constexpr int capacity = 512;
+
+	juce::AbstractFifo fifo { capacity };
+	std::array<BlockMetrics, capacity> buffer;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetricsFifo)
+};
+
+// Drains the FIFO on the message thread and keeps running totals for the
+// editor. Every block can also be passed to an optional log sink, e.g.
+// juce::Logger::writeToLog.
+class MetricsPublisher : private juce::Timer
+{
+public:
+	explicit MetricsPublisher(MetricsFifo& source)
+		: fifo(source)
+	{
+		startTimerHz(20);
+	}
+
+	~MetricsPublisher() override {}
+
+	struct Totals
+	{
+		BlockMetrics latest;
+		uint64_t blocks = 0;
+		uint64_t solves = 0;
+		uint64_t iterations = 0;
+		uint64_t capHits = 0;
+		uint32_t maxIterations = 0;
+		float peakLoad = 0.f;
+		uint64_t qualityChanges = 0;
+
+		// Levels count down from full quality, so this is the highest level
+		uint32_t lowestQuality = 0;
+	};
+
+	const Totals& getTotals() const { return totals; }
+
+	void resetTotals() { totals = Totals(); }
+
+	std::function<void()> onUpdate;
+	std::function<void(const juce::String&)> logSink;
+
+private:
+	MetricsFifo& fifo;
+	Totals totals;
+
+	void timerCallback() override
+	{
+		bool updated = false;
+
+		fifo.popAll([this, &updated](const BlockMetrics& metrics)
+		{
+			if (totals.blocks > 0 && metrics.qualityLevel != totals.latest.qualityLevel)
+				++totals.qualityChanges;
+
+			totals.latest = metrics;
+			++totals.blocks;
+			totals.solves += metrics.solves;
+			totals.iterations += metrics.iterations;
+			totals.capHits += metrics.capHits;
+			totals.maxIterations = juce::jmax(totals.maxIterations, metrics.maxIterations);
+			totals.peakLoad = juce::jmax(totals.peakLoad, metrics.load);
+			totals.lowestQuality = juce::jmax(totals.lowestQuality, metrics.qualityLevel);
+			updated = true;
+
+			if (logSink != nullptr)
+				logSink("block " + juce::String((juce::int64) totals.blocks)
+								   + ": iterations " + juce::String(metrics.iterations)
+								   + ", max " + juce::String(metrics.maxIterations)
+								   + ", cap hits " + juce::String(metrics.capHits)
+								   + ", load " + juce::String(metrics.load * 100.f, 1) + "%"
+								   + ", quality " + QualityGovernor::getLevelName((QualityGovernor::Level) metrics.qualityLevel));
+		});
+
+		if (updated && onUpdate != nullptr)
+			onUpdate();
+	}
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetricsPublisher)
+};
+
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DKMethod.h"
+
+// Circuits for DKClipper. Node 0 is ground and node 1 the input.
+namespace Netlists
+{
+	// Series resistor into a capacitor and an anti-parallel diode pair to
+	// ground
+	struct SymmetricDiodeClipper
+	{
+		static constexpr size_t numNodes = 2;
+		static constexpr size_t outputNode = 2;
+
+		static constexpr std::array<DK::Component, 4> components {{
+			DK::inputSource(1, 0),
+			DK::resistor(1, 2, 2200.f),
+			DK::capacitor(2, 0, 10e-9f),
+			DK::diodePair(2, 0, DiodePair { (float) 1e-15, 1.f })
+		}};
+	};
+
+	// As above, with one diode conducting positive swings and two in series
+	// conducting negative ones, so the negative side clips about twice as
+	// high. The node between the series pair would only connect to diodes,
+	// which leaves the linear system singular, so the pair is one diode with
+	// twice the ideality.
+	struct AsymmetricDiodeClipper
+	{
+		static constexpr size_t numNodes = 2;
+		static constexpr size_t outputNode = 2;
+
+		static constexpr std::array<DK::Component, 5> components {{
+			DK::inputSource(1, 0),
+			DK::resistor(1, 2, 2200.f),
+			DK::capacitor(2, 0, 10e-9f),
+			DK::diode(2, 0, DiodePair { (float) 1e-15, 1.f }),
+			DK::diode(0, 2, DiodePair { (float) 1e-15, 2.f })
+		}};
+	};
+
+	// NonInvertingOpAmpClipper's circuit. The op-amp's output is node 3, and
+	// R4 and C1 take the inverting input to ground through node 4.
+	struct NonInvertingOpAmp
+	{
+		static constexpr size_t numNodes = 4;
+		static constexpr size_t outputNode = 3;
+
+		static constexpr std::array<DK::Component, 7> components {{
+			DK::inputSource(1, 0),
+			DK::opAmp(1, 2, 3),
+			DK::resistor(2, 4, 4700.f),
+			DK::capacitor(4, 0, 47e-9f),
+			DK::resistor(3, 2, 551000.f),
+			DK::capacitor(3, 2, 51e-12f),
+			DK::diodePair(3, 2, DiodePair { (float) 10e-12, 1.2f })
+		}};
+	};
+}
@@ -20,77 +20,926 @@
 #pragma once
 
 #include "ClipperBase.h"
+#include "SolverStats.h"
+#include "SharedResourceCache.h"
 
-class NonInvertingOpAmpClipper : public ClipperBase
+template <typename SampleType>
+class NonInvertingOpAmpClipper : public ClipperBase<NonInvertingOpAmpClipper<SampleType>, SampleType>
 {
+	using Base = ClipperBase<NonInvertingOpAmpClipper<SampleType>, SampleType>;
+	using Base::Ts;
+	using Base::samplePeriod;
+	using Base::clippingDiodePair;
+	using Base::getCapResistance;
+
 public:
 	NonInvertingOpAmpClipper() {}
 	~NonInvertingOpAmpClipper() {}
 
+	using Base::maxChannels;
+	using Base::defaultMaxIterations;
+
+	enum class SolverMode
+	{
+		newtonRaphson,
+		lookupTable
+	};
+
+	void setSolverMode(SolverMode newMode)
+	{
+		if (solverMode == newMode)
+			return;
+
+		solverMode = newMode;
+
+		if (solverMode == SolverMode::lookupTable && table == nullptr)
+			loadTable();
+	}
+
+	SolverMode getSolverMode() const { return solverMode; }
+
+	// Keeps the table loaded in Newton-Raphson mode too, so switching to it
+	// later, e.g. from the quality governor, is only a change of solver
+	void setKeepTableReady(bool shouldKeepTable)
+	{
+		keepTableReady = shouldKeepTable;
+
+		if (keepTableReady && table == nullptr)
+			loadTable();
+	}
+
+	// Fetches the lookup tables for the sample rates the circuit may be
+	// reset() to, so reset() finds them without building them. The tables
+	// are shared by every instance in the process. Allocates and may build
+	// them, so call it from prepare. The circuit never builds a table itself,
+	// and iterates at any rate that wasn't prepared.
+	//
+	// Only the table solver and setKeepTableReady() need the tables, so
+	// without either the ones held are released and none are fetched.
+	// isMissingTables() then says when they are wanted.
+	void prepareSampleRates(const std::vector<float>& sampleRates)
+	{
+		std::vector<std::shared_ptr<const Table>> tables;
+
+		if (isUsingTables())
+		{
+			for (auto Fs : sampleRates)
+			{
+				const auto key = getTableKey((float) ((SampleType) 1 / (SampleType) Fs));
+
+				if (std::none_of(tables.begin(), tables.end(), [&key](const auto& prepared) { return prepared->key == key; }))
+					tables.push_back(TableCache::getInstance().get(key, [this, &key] { return buildTable(key); }));
+			}
+		}
+
+		// The tables already held stay alive until the new ones are in, so
+		// the rates prepared before aren't built again
+		std::swap(preparedTables, tables);
+		reloadTable();
+	}
+
+	// True when the table solver or setKeepTableReady() wants tables that
+	// prepareSampleRates() didn't fetch
+	bool isMissingTables() const { return isUsingTables() && preparedTables.empty(); }
+
+	// Swaps prepared tables with another instance, e.g. one that fetched them
+	// on a background thread. Doesn't allocate or free, so it's safe on the
+	// audio thread; the tables this held are left to the other instance.
+	void swapPreparedTables(NonInvertingOpAmpClipper& other)
+	{
+		std::swap(preparedTables, other.preparedTables);
+		reloadTable();
+		other.reloadTable();
+	}
+
+	// Cap on Newton iterations per sample, 50 by default. The table is always
+	// built with the full cap.
+	void setMaxIterations(uint32_t newMaxIterations) { maxIterations = juce::jmax((uint32_t) 1, newMaxIterations); }
+	uint32_t getMaxIterations() const { return maxIterations; }
+
+	void setDiodePrecision(DiodePrecision newPrecision) { diodePrecision = newPrecision; }
+	DiodePrecision getDiodePrecision() const { return diodePrecision; }
+
+	// single runs the circuit in its sample type. mixed keeps float audio in
+	// float but runs the states and the Newton iteration in double, with
+	// exact diodes, so the residual threshold stays reachable where float
+	// rounding would hold the residual above it. On double blocks the two
+	// are the same. The lookup table is float either way.
+	enum class SolverPrecision
+	{
+		single,
+		mixed
+	};
+
+	// The states carry over, so switching doesn't interrupt the sound
+	void setSolverPrecision(SolverPrecision newPrecision)
+	{
+		if (solverPrecision == newPrecision)
+			return;
+
+		for (size_t channel = 0; channel < maxChannels; ++channel)
+		{
+			auto& state = doubleStates[channel];
+
+			if (newPrecision == SolverPrecision::mixed)
+			{
+				state = { X1[channel], X2[channel], Vd[channel], VdPrev[channel] };
+			}
+			else
+			{
+				X1[channel] = (SampleType) state.x1;
+				X2[channel] = (SampleType) state.x2;
+				Vd[channel] = (SampleType) state.vd;
+				VdPrev[channel] = (SampleType) state.vdPrev;
+			}
+		}
+
+		solverPrecision = newPrecision;
+	}
+
+	SolverPrecision getSolverPrecision() const { return solverPrecision; }
+
+	// Where each sample's Newton iteration starts
+	enum class Predictor
+	{
+		previousSample,
+		linearExtrapolation,
+		explicitEstimate
+	};
+
+	void setPredictor(Predictor newPredictor) { predictor = newPredictor; }
+	Predictor getPredictor() const { return predictor; }
+
+	// Keeps the current solver mode, iteration cap and predictor running
+	// alongside the ones set next, for the next numSamples at each channel,
+	// and crossfades from their output to the new one's. The two start from
+	// the same states, so a change of solver mid-note doesn't step the output.
+	void beginSolverFade(size_t numSamples)
+	{
+		fade.solverMode = solverMode;
+		fade.maxIterations = maxIterations;
+		fade.predictor = predictor;
+		fade.X1 = X1;
+		fade.X2 = X2;
+		fade.Vd = Vd;
+		fade.VdPrev = VdPrev;
+		fade.doubleStates = doubleStates;
+		fade.length = (uint32_t) juce::jmax((size_t) 1, numSamples);
+		fade.remaining.fill(fade.length);
+	}
+
+	// residual stops once |f(Vd)| < thr. stepSize also stops once the full
+	// Newton step is below stepThr. At high currents float rounding keeps the
+	// residual above thr, so residual alone runs into the iteration cap there.
+	enum class ConvergenceCriterion
+	{
+		residual,
+		stepSize
+	};
+
+	void setConvergenceCriterion(ConvergenceCriterion newCriterion) { criterion = newCriterion; }
+	ConvergenceCriterion getConvergenceCriterion() const { return criterion; }
+
+	// Largest deviation of the lookup table from the iterative solver,
+	// measured halfway between table points when the table was built
+	float getTableMaxError() const { return table != nullptr ? table->maxError : 0.f; }
+
+	// Iteration counts gathered while SYN_SOLVER_STATS is enabled
+	const SolverStats& getSolverStats() const { return stats; }
+	void resetSolverStats() { stats.clear(); }
+
+	// X1 and X2 are the capacitors' companion currents, so times their
+	// resistances they are voltages like Vd
+	bool isQuiescent(float tolerance) const
+	{
+		if (solverPrecision == SolverPrecision::mixed)
+		{
+			const auto& c = doubleCoefficients;
+
+			for (const auto& state : doubleStates)
+				if (std::abs(state.vd) > tolerance || std::abs(state.x1 * c.R1) > tolerance || std::abs(state.x2 * c.R2) > tolerance)
+					return false;
+
+			return true;
+		}
+
+		for (size_t channel = 0; channel < maxChannels; ++channel)
+			if (abs(Vd[channel]) > (SampleType) tolerance || abs(X1[channel] * R1) > (SampleType) tolerance
+				|| abs(X2[channel] * R2) > (SampleType) tolerance)
+				return false;
+
+		return true;
+	}
+
+	void clearState()
+	{
+		X1.fill((SampleType) 0);
+		X2.fill((SampleType) 0);
+		Vd.fill((SampleType) 0);
+		VdPrev.fill((SampleType) 0);
+		doubleStates.fill({});
+		fade.remaining.fill(0);
+	}
+
+	// The values the components are gliding to, so the tail covers the
+	// circuit once they settle
+	float getTimeConstant() const
+	{
+		return (float) juce::jmax(smoothedR4.getTargetValue() * smoothedC1.getTargetValue(),
+								  smoothedR3.getTargetValue() * smoothedC2.getTargetValue());
+	}
+
+	// The components the circuit's parameters control, in farads and ohms.
+	// The setters only set the target. process() glides the components
+	// there over componentRampTime, stepping them every componentStep
+	// samples and recomputing only the coefficients that depend on the ones
+	// that moved, so automating them costs a few updates per block rather
+	// than one per change, and doesn't zipper. reset() jumps to the targets.
+	void setC1(float farads) { smoothedC1.setTargetValue((SampleType) farads); }
+	void setR4(float ohms)   { smoothedR4.setTargetValue((SampleType) ohms); }
+	void setC2(float farads) { smoothedC2.setTargetValue((SampleType) farads); }
+
+	// R3 is the drive pot in series with a fixed 51k
+	void setDrive(float potOhms) { smoothedR3.setTargetValue((SampleType) driveSeriesResistance + (SampleType) potOhms); }
+
+	static constexpr float driveSeriesResistance = 51000.f;
+	static constexpr float maxDrive = 500e3f;
+
+	// The range of the C2 parameter. With the drive's, it sets the range of
+	// conductances the lookup table covers.
+	static constexpr float minC2 = 10e-12f;
+	static constexpr float maxC2 = 1e-9f;
+
+	static constexpr double componentRampTime = 0.02;
+	static constexpr size_t componentStep = 8;
+
+	// Moves the gliding components one step and recomputes only what they
+	// feed into: C1 and R4 set the input branch, C2 and R3 the feedback
+	// network. Returns the samples the new coefficients hold for, the whole
+	// of numSamples once nothing glides.
+	size_t applyPendingChanges(size_t numSamples)
+	{
+		if (! (smoothedC1.isSmoothing() || smoothedR4.isSmoothing() || smoothedC2.isSmoothing() || smoothedR3.isSmoothing()))
+			return numSamples;
+
+		const auto length = juce::jmin(numSamples, componentStep);
+
+		const auto changes = advanceComponent(C1, smoothedC1, length, inputBranchChanged)
+						   | advanceComponent(R4, smoothedR4, length, inputBranchChanged)
+						   | advanceComponent(C2, smoothedC2, length, feedbackChanged)
+						   | advanceComponent(R3, smoothedR3, length, feedbackChanged);
+
+		if ((changes & inputBranchChanged) != 0)
+			updateInputBranch();
+
+		if ((changes & feedbackChanged) != 0)
+			updateFeedback();
+
+		return length;
+	}
+
 private:
+	friend Base;
+
 	// Components
-	float C1 = (float) 47e-9;
-	float R1 = getCapResistance(C1);
-	const float R4 = 4700.f;
+	SampleType C1 = (SampleType) 47e-9;
+	SampleType R1 = getCapResistance(C1);
+	SampleType R4 = (SampleType) 4700;
 
-	float C2 = (float) 51e-12;
-	float R2 = getCapResistance(C1);
-	const float R3 = 51000.f + 500e3;
+	SampleType C2 = (SampleType) 51e-12;
+	SampleType R2 = getCapResistance(C1);
+	SampleType R3 = (SampleType) driveSeriesResistance + (SampleType) maxDrive;
+
+	using SmoothedComponent = juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Multiplicative>;
+
+	SmoothedComponent smoothedC1 { C1 };
+	SmoothedComponent smoothedR4 { R4 };
+	SmoothedComponent smoothedC2 { C2 };
+	SmoothedComponent smoothedR3 { R3 };
+
+	// Which coefficients a component moving invalidates
+	enum ComponentChanges : uint32_t
+	{
+		inputBranchChanged = 1 << 0,
+		feedbackChanged    = 1 << 1
+	};
 
 	// Combined Resistances
-	float G1 = (1.f + R4 / R1);
-	float G4 = (1.f + R1 / R4);
+	SampleType G1 = ((SampleType) 1 + R4 / R1);
+	SampleType G4 = ((SampleType) 1 + R1 / R4);
 
-	// States
-	float X1 = 0.f;
-	float X2 = 0.f;
-	float Vd = 0.f;
+	// The coefficients the scalar solver runs on, in the sample type and in
+	// double for mixed precision. G is the conductance across the diodes.
+	template <typename T>
+	struct Coefficients
+	{
+		T R1, R2, R4, G1, G4, G;
+	};
+
+	Coefficients<SampleType> coefficients { R1, R2, R4, G1, G4, (SampleType) 1 / R2 + (SampleType) 1 / R3 };
+	Coefficients<double> doubleCoefficients { R1, R2, R4, G1, G4, 1.0 / R2 + 1.0 / R3 };
+
+	// States, one per channel
+	alignas(16) std::array<SampleType, maxChannels> X1 {};
+	alignas(16) std::array<SampleType, maxChannels> X2 {};
+	alignas(16) std::array<SampleType, maxChannels> Vd {};
+	alignas(16) std::array<SampleType, maxChannels> VdPrev {};
+
+	struct DoubleState
+	{
+		double x1 = 0.0, x2 = 0.0, vd = 0.0, vdPrev = 0.0;
+	};
+
+	std::array<DoubleState, maxChannels> doubleStates {};
+
+	// The outgoing solver while beginSolverFade() crossfades, with its own
+	// copy of the states. remaining counts down the samples left at each
+	// channel.
+	struct SolverFade
+	{
+		SolverMode solverMode = SolverMode::newtonRaphson;
+		uint32_t maxIterations = defaultMaxIterations;
+		Predictor predictor = Predictor::previousSample;
+		std::array<SampleType, maxChannels> X1 {}, X2 {}, Vd {}, VdPrev {};
+		std::array<DoubleState, maxChannels> doubleStates {};
+		std::array<uint32_t, maxChannels> remaining {};
+		uint32_t length = 1;
+	};
+
+	SolverFade fade;
 
 	const float thr = 0.00000000001f;
+	const float stepThr = 0.000001f;
+
+	// Lookup Table
+	// Vd is tabulated against u = asinh(-p / (G * tableScale)) and ln G, G
+	// being the conductance across the diodes. -p / G is what Vd would be
+	// without the diodes, so at small signals Vd is the same on every slice,
+	// and once the diodes conduct it is roughly linear in both u and ln G.
+	// The table stays accurate with bilinear interpolation over many decades
+	// of p and the whole range of C2 and the drive.
+	static constexpr size_t tableSize = 2048;
+	static constexpr size_t tableSlices = 32;
+	static constexpr float tableScale = (float) 1e-3;
+	static constexpr float tableRange = 17.f;
+
+	SolverMode solverMode = SolverMode::newtonRaphson;
+	SolverPrecision solverPrecision = SolverPrecision::single;
+	bool keepTableReady = false;
+	uint32_t maxIterations = defaultMaxIterations;
+	DiodePrecision diodePrecision = DiodePrecision::simd;
+	Predictor predictor = Predictor::previousSample;
+	ConvergenceCriterion criterion = ConvergenceCriterion::stepSize;
+
+	// The sample rate sets the range of G the slices cover
+	struct TableKey
+	{
+		float Ts;
+		DiodePrecision precision;
+		ConvergenceCriterion criterion;
+
+		bool operator== (const TableKey& other) const
+		{
+			return Ts == other.Ts && precision == other.precision && criterion == other.criterion;
+		}
+	};
+
+	// tableSlices rows of tableSize values, one row per G
+	struct Table
+	{
+		TableKey key;
+		std::vector<float> values;
+		float maxError = 0.f;
+	};
 
-	float processSingleSample(float Vin)
+	using TableCache = SharedResourceCache<TableKey, Table>;
+
+	std::shared_ptr<const Table> table;
+	std::vector<std::shared_ptr<const Table>> preparedTables;
+
+	// Where the current G falls between the slices, set with the coefficients
+	float tableSlicePosition = 0.f;
+
+	mutable SolverStats stats;
+
+	template <typename T>
+	T solveNewton(T p, T V, T G) const
+	{
+		if constexpr (std::is_same_v<T, double>)
+			return solveNewton<DiodePrecision::exact>(p, V, G);
+
+		if (diodePrecision == DiodePrecision::exact)
+			return solveNewton<DiodePrecision::exact>(p, V, G);
+
+		return solveNewton<DiodePrecision::fast>(p, V, G);
+	}
+
+	// precision only applies to float, the double diodes are always exact
+	template <DiodePrecision precision, typename T>
+	static void evaluateDiodes(T V, T& current, T& conductance)
 	{
-		size_t iter = 1;
-		float b = 1.f;
+		if constexpr (std::is_same_v<T, double>)
+			clippingDiodePair.evaluate(V, current, conductance);
+		else
+			clippingDiodePair.template evaluate<precision>(V, current, conductance);
+	}
+
+	template <DiodePrecision precision, typename T>
+	T solveNewton(T p, T V, T G) const
+	{
+		uint32_t iter = 1;
+		T b = (T) 1;
 
-		float p = -Vin / (G4 * R4) + R1 / (G4 * R4) * X1 - X2;
+	   #if SYN_SOLVER_STATS
+		uint32_t backtracks = 0;
+	   #endif
 
-		float fVd = p + Vd / R2 + Vd / R3 + positiveDiode(Vd) + negativeDiode(Vd);
+		T current, conductance;
+		bool converged = false;
 
-		while (iter < 50 && abs(fVd) > thr)
+		evaluateDiodes<precision>(V, current, conductance);
+		T fVd = p + V * G + current;
+
+		while (iter < maxIterations && abs(fVd) > (T) thr)
 		{
-			float fpVd = positiveDiode(Vd, true) + negativeDiode(Vd, true) + 1.f / R2 + 1.f / R3;
-			float Vnew = Vd - b * fVd / fpVd;
-			float fn = p + Vnew / R2 + Vnew / R3 + positiveDiode(Vnew) + negativeDiode(Vnew);
+			T fpVd = conductance + G;
+			T step = fVd / fpVd;
+
+			// A step this small is taken without checking the residual again
+			if (criterion == ConvergenceCriterion::stepSize && abs(step) < (T) stepThr)
+			{
+				V -= step;
+				converged = true;
+				break;
+			}
+
+			T Vnew = V - b * step;
+
+			T currentNew, conductanceNew;
+			evaluateDiodes<precision>(Vnew, currentNew, conductanceNew);
+			T fn = p + Vnew * G + currentNew;
 
 			if (abs(fn) < abs(fVd))
 			{
-				Vd = Vnew;
-				b = 1.f;
+				// The candidate's residual and conductance are kept for the
+				// next step instead of being evaluated again
+				V = Vnew;
+				fVd = fn;
+				conductance = conductanceNew;
+				b = (T) 1;
 			}
 			else
 			{
-				b *= 0.5f;
+				b *= (T) 0.5;
+
+			   #if SYN_SOLVER_STATS
+				++backtracks;
+			   #endif
 			}
 
-			fVd = p + Vd / R2 + Vd / R3 + positiveDiode(Vd) + negativeDiode(Vd);
 			iter++;
 		}
 
-		float Vout = Vd + Vin;
-		X1 = (2.f / R1) * (Vin / G1 + X1 * R4 / G1) - X1;
-    	X2 = (2.f / R2) * (Vd) - X2;
+	   #if SYN_SOLVER_STATS
+		stats.add((uint32_t) iter - 1, backtracks, ! converged && abs(fVd) > (T) thr);
+	   #else
+		juce::ignoreUnused(converged);
+	   #endif
+
+		return V;
+	}
+
+	// Falls back to the iterative solver outside the table, for signals too
+	// large for it or G outside the parameters' range
+	float solveTable(const Table& lookup, float p, float V, float G, float slicePosition) const
+	{
+		const float u = std::asinh(-p / (G * tableScale));
+		const float position = (u + tableRange) * (float) (tableSize - 1) / (2.f * tableRange);
+
+		if (! (position >= 0.f && position < (float) (tableSize - 1)
+			   && slicePosition >= 0.f && slicePosition <= (float) (tableSlices - 1)))
+			return solveNewton(p, V, G);
+
+		const auto index = (size_t) position;
+		const float frac = position - (float) index;
+
+		const auto slice = juce::jmin((size_t) slicePosition, tableSlices - 2);
+		const float sliceFrac = slicePosition - (float) slice;
+
+		const float* lower = lookup.values.data() + slice * tableSize + index;
+		const float* upper = lower + tableSize;
+
+		const float below = lower[0] + frac * (lower[1] - lower[0]);
+		const float above = upper[0] + frac * (upper[1] - upper[0]);
+
+		return below + sliceFrac * (above - below);
+	}
+
+	static float tablePosition(size_t index, float G, float offset = 0.f)
+	{
+		const float u = -tableRange + ((float) index + offset) * 2.f * tableRange / (float) (tableSize - 1);
+		return -G * tableScale * std::sinh(u);
+	}
+
+	// ln G at the first slice and between slices, for the conductances the
+	// C2 and drive ranges give at sample period newTs
+	struct SliceSpacing
+	{
+		float start, step;
+	};
+
+	static SliceSpacing getSliceSpacing(float newTs)
+	{
+		const float minG = 2.f * minC2 / newTs + 1.f / (driveSeriesResistance + maxDrive);
+		const float maxG = 2.f * maxC2 / newTs + 1.f / driveSeriesResistance;
+
+		return { std::log(minG), (std::log(maxG) - std::log(minG)) / (float) (tableSlices - 1) };
+	}
+
+	static float getSliceConductance(const SliceSpacing& spacing, float slicePosition)
+	{
+		return std::exp(spacing.start + slicePosition * spacing.step);
+	}
+
+	TableKey getTableKey(float newTs) const
+	{
+		return { newTs, diodePrecision, criterion };
+	}
+
+	// Solves every table point by sweeping p along each slice, warm starting
+	// each solve from its neighbour, then checks the interpolated values in
+	// the middle of every cell. Uses this instance's solver, so the key's
+	// precision and criterion must be the current ones.
+	Table buildTable(const TableKey& key)
+	{
+		jassert (key.precision == diodePrecision && key.criterion == criterion);
+
+	   #if SYN_SOLVER_STATS
+		const auto statsBeforeBuild = stats;
+	   #endif
+
+		const auto cap = maxIterations;
+		maxIterations = defaultMaxIterations;
+
+		Table result;
+		result.key = key;
+		result.values.resize(tableSlices * tableSize);
+
+		const auto spacing = getSliceSpacing(key.Ts);
+		const size_t centre = tableSize / 2;
+
+		for (size_t slice = 0; slice < tableSlices; ++slice)
+		{
+			const float G = getSliceConductance(spacing, (float) slice);
+			auto* values = result.values.data() + slice * tableSize;
+			float V = 0.f;
+
+			for (size_t i = centre; i < tableSize; ++i)
+				V = values[i] = solveNewton(tablePosition(i, G), V, G);
+
+			V = values[centre];
+
+			for (size_t i = centre; i-- > 0;)
+				V = values[i] = solveNewton(tablePosition(i, G), V, G);
+		}
+
+		for (size_t slice = 0; slice + 1 < tableSlices; ++slice)
+		{
+			const float slicePosition = (float) slice + 0.5f;
+			const float G = getSliceConductance(spacing, slicePosition);
+			const auto* values = result.values.data() + slice * tableSize;
+
+			for (size_t i = 0; i + 1 < tableSize; ++i)
+			{
+				const float p = tablePosition(i, G, 0.5f);
+				const float error = abs(solveTable(result, p, values[i], G, slicePosition) - solveNewton(p, values[i], G));
+				result.maxError = juce::jmax(result.maxError, error);
+			}
+		}
+
+		maxIterations = cap;
+
+	   #if SYN_SOLVER_STATS
+		stats = statsBeforeBuild;
+	   #endif
+
+		return result;
+	}
+
+	// Takes the table for the current sample rate from the prepared ones.
+	// A table is never built here, since this runs on the audio thread from
+	// reset() and the solver setters.
+	void loadTable()
+	{
+		const auto key = getTableKey((float) Ts);
+		table = nullptr;
+
+		for (const auto& prepared : preparedTables)
+		{
+			if (prepared->key == key)
+			{
+				table = prepared;
+				return;
+			}
+		}
+	}
+
+	bool isUsingTables() const
+	{
+		return solverMode == SolverMode::lookupTable || keepTableReady;
+	}
+
+	void reloadTable()
+	{
+		table = nullptr;
+
+		if (isUsingTables())
+			loadTable();
+	}
+
+	// Vd with only the resistors or only the diodes conducting. Both overshoot
+	// the real solution, so the one closer to zero is the better guess.
+	template <typename T>
+	T explicitEstimate(T p, T G) const
+	{
+		const T resistive = -p / G;
+		const T diodes = std::asinh(-p / ((T) 2 * (T) clippingDiodePair.Is)) / (T) clippingDiodePair.invNVt;
+
+		return abs(resistive) < abs(diodes) ? resistive : diodes;
+	}
+
+	float explicitEstimate(float p) const
+	{
+		return explicitEstimate(p, (float) coefficients.G);
+	}
+
+	template <typename T>
+	T predict(T p, T vd, T vdPrev, T G) const
+	{
+		switch (predictor)
+		{
+			case Predictor::linearExtrapolation: return (T) 2 * vd - vdPrev;
+			case Predictor::explicitEstimate:    return explicitEstimate(p, G);
+			case Predictor::previousSample:      break;
+		}
+
+		return vd;
+	}
+
+	SampleType processSingleSample(SampleType Vin, size_t channel)
+	{
+		if (fade.remaining[channel] > 0)
+			return processFadingSample(Vin, channel);
+
+		return processSolver(Vin, channel);
+	}
+
+	// Runs both solvers, swapping the outgoing one's settings and states in
+	// and back out around its sample
+	SampleType processFadingSample(SampleType Vin, size_t channel)
+	{
+		const SampleType incoming = processSolver(Vin, channel);
+
+		swapFadeSolver(channel);
+		const SampleType outgoing = processSolver(Vin, channel);
+		swapFadeSolver(channel);
+
+		const SampleType position = (SampleType) (fade.length - --fade.remaining[channel]) / (SampleType) fade.length;
+		return outgoing + position * (incoming - outgoing);
+	}
+
+	void swapFadeSolver(size_t channel)
+	{
+		std::swap(solverMode, fade.solverMode);
+		std::swap(maxIterations, fade.maxIterations);
+		std::swap(predictor, fade.predictor);
+		std::swap(X1[channel], fade.X1[channel]);
+		std::swap(X2[channel], fade.X2[channel]);
+		std::swap(Vd[channel], fade.Vd[channel]);
+		std::swap(VdPrev[channel], fade.VdPrev[channel]);
+		std::swap(doubleStates[channel], fade.doubleStates[channel]);
+	}
+
+	SampleType processSolver(SampleType Vin, size_t channel)
+	{
+		if (solverPrecision == SolverPrecision::mixed)
+		{
+			auto& state = doubleStates[channel];
+			return (SampleType) processCircuit<double>(Vin, state.x1, state.x2, state.vd, state.vdPrev, doubleCoefficients);
+		}
+
+		return processCircuit<SampleType>(Vin, X1[channel], X2[channel], Vd[channel], VdPrev[channel], coefficients);
+	}
+
+	template <typename T>
+	T processCircuit(T Vin, T& x1, T& x2, T& vd, T& vdPrev, const Coefficients<T>& c)
+	{
+		T p = -Vin / (c.G4 * c.R4) + c.R1 / (c.G4 * c.R4) * x1 - x2;
+
+		const T guess = predict(p, vd, vdPrev, c.G);
+		vdPrev = vd;
+
+		if (solverMode == SolverMode::lookupTable && table != nullptr)
+			vd = (T) solveTable(*table, (float) p, (float) vd, (float) coefficients.G, tableSlicePosition);
+		else
+			vd = solveNewton(p, guess, c.G);
+
+		T Vout = vd + Vin;
+		x1 = ((T) 2 / c.R1) * (Vin / c.G1 + x1 * c.R4 / c.G1) - x1;
+    	x2 = ((T) 2 / c.R2) * (vd) - x2;
 
 		return Vout;
 	}
 
+   #if JUCE_USE_SIMD
+	// Same solver as solveNewton, run on one channel per lane. Lanes that have
+	// converged are masked out of further updates while the others iterate.
+	// Only float blocks run in lanes.
+	void processLanes(const float* const* src, float* const* dst, size_t firstChannel, size_t numLanes, size_t numSamples,
+	                  const typename Base::Gains& gains)
+	{
+		using namespace SIMDMath;
+
+		if ((solverMode == SolverMode::lookupTable && table != nullptr) || diodePrecision != DiodePrecision::simd
+		    || solverPrecision == SolverPrecision::mixed || isFading(firstChannel, numLanes))
+		{
+			Base::processLanes(src, dst, firstChannel, numLanes, numSamples, gains);
+			return;
+		}
+
+		const float G = coefficients.G;
+
+		Vec x1 = Vec::fromRawArray(X1.data() + firstChannel);
+		Vec x2 = Vec::fromRawArray(X2.data() + firstChannel);
+		Vec V  = Vec::fromRawArray(Vd.data() + firstChannel);
+		Vec Vprev = Vec::fromRawArray(VdPrev.data() + firstChannel);
+
+		alignas(16) float frame[Vec::SIMDNumElements] = {};
+
+		for (size_t i = 0; i < numSamples; ++i)
+		{
+			for (size_t lane = 0; lane < numLanes; ++lane)
+				frame[lane] = gains.applyPre(src[lane][i], i);
+
+			const Vec Vin = Vec::fromRawArray(frame);
+			const Vec p = Vin * (-1.f / (G4 * R4)) + x1 * (R1 / (G4 * R4)) - x2;
+			const Vec Vlast = V;
+
+			if (predictor == Predictor::linearExtrapolation)
+			{
+				V = V * 2.f - Vprev;
+			}
+			else if (predictor == Predictor::explicitEstimate)
+			{
+				for (size_t lane = 0; lane < Vec::size(); ++lane)
+					V.set(lane, explicitEstimate(p.get(lane)));
+			}
+
+			Vprev = Vlast;
+
+			Vec current, conductance;
+			clippingDiodePair.evaluate(V, current, conductance);
+
+			Vec fVd = p + V * G + current;
+			Vec b = Vec::expand(1.f);
+			Mask active = Vec::greaterThan(abs(fVd), Vec::expand(thr));
+
+		   #if SYN_SOLVER_STATS
+			Mask iterations = Mask::expand(0u), backtracks = Mask::expand(0u);
+		   #endif
+
+			for (uint32_t iter = 1; iter < maxIterations && any(active); ++iter)
+			{
+				const Vec step = divide(fVd, conductance + G);
+
+				if (criterion == ConvergenceCriterion::stepSize)
+				{
+					const Mask small = active & Vec::lessThan(abs(step), Vec::expand(stepThr));
+
+					V = select(small, V - step, V);
+					active = active & ~small;
+
+					if (! any(active))
+						break;
+				}
+
+			   #if SYN_SOLVER_STATS
+				iterations = iterations + (active & Mask::expand(1u));
+			   #endif
+
+				const Vec Vnew = V - b * step;
+
+				Vec currentNew, conductanceNew;
+				clippingDiodePair.evaluate(Vnew, currentNew, conductanceNew);
+
+				const Vec fn = p + Vnew * G + currentNew;
+				const Mask accepted = active & Vec::lessThan(abs(fn), abs(fVd));
+				const Mask rejected = active & ~accepted;
+
+				V = select(accepted, Vnew, V);
+				fVd = select(accepted, fn, fVd);
+				conductance = select(accepted, conductanceNew, conductance);
+				b = select(accepted, Vec::expand(1.f), select(rejected, b * 0.5f, b));
+
+				active = active & Vec::greaterThan(abs(fVd), Vec::expand(thr));
+
+			   #if SYN_SOLVER_STATS
+				backtracks = backtracks + (rejected & Mask::expand(1u));
+			   #endif
+			}
+
+		   #if SYN_SOLVER_STATS
+			for (size_t lane = 0; lane < numLanes; ++lane)
+				stats.add(iterations.get(lane), backtracks.get(lane), active.get(lane) != 0u);
+		   #endif
+
+			const Vec Vout = V + Vin;
+			x1 = (Vin * (1.f / G1) + x1 * (R4 / G1)) * (2.f / R1) - x1;
+			x2 = V * (2.f / R2) - x2;
+
+			Vout.copyToRawArray(frame);
+
+			for (size_t lane = 0; lane < numLanes; ++lane)
+				dst[lane][i] = gains.applyPost(frame[lane], i);
+		}
+
+		x1.copyToRawArray(X1.data() + firstChannel);
+		x2.copyToRawArray(X2.data() + firstChannel);
+		V .copyToRawArray(Vd.data() + firstChannel);
+		Vprev.copyToRawArray(VdPrev.data() + firstChannel);
+	}
+   #endif
+
+	bool isFading(size_t firstChannel, size_t numChannels) const
+	{
+		for (size_t channel = firstChannel; channel < firstChannel + numChannels; ++channel)
+			if (fade.remaining[channel] > 0)
+				return true;
+
+		return false;
+	}
+
 	void updateCoefficients()
+	{
+		const auto sampleRate = 1.0 / samplePeriod;
+
+		for (auto* smoothed : { &smoothedC1, &smoothedR4, &smoothedC2, &smoothedR3 })
+			smoothed->reset(sampleRate, componentRampTime);
+
+		C1 = smoothedC1.getTargetValue();
+		R4 = smoothedR4.getTargetValue();
+		C2 = smoothedC2.getTargetValue();
+		R3 = smoothedR3.getTargetValue();
+
+		updateInputBranch();
+		updateFeedback();
+
+		reloadTable();
+	}
+
+	void updateInputBranch()
 	{
 		R1 = getCapResistance(C1);
+		G1 = ((SampleType) 1 + R4 / R1);
+		G4 = ((SampleType) 1 + R1 / R4);
+
+		auto& s = coefficients;
+		s.R1 = R1;
+		s.R4 = R4;
+		s.G1 = G1;
+		s.G4 = G4;
+
+		auto& c = doubleCoefficients;
+		c.R1 = getCapResistance((double) C1);
+		c.R4 = R4;
+		c.G1 = 1.0 + c.R4 / c.R1;
+		c.G4 = 1.0 + c.R1 / c.R4;
+	}
+
+	void updateFeedback()
+	{
 		R2 = getCapResistance(C2);
 
-		G1 = (1.f + R4 / R1);
-		G4 = (1.f + R1 / R4);
+		coefficients.R2 = R2;
+		coefficients.G = (SampleType) 1 / R2 + (SampleType) 1 / R3;
+
+		auto& c = doubleCoefficients;
+		c.R2 = getCapResistance((double) C2);
+		c.G = 1.0 / c.R2 + 1.0 / (double) R3;
+
+		const auto spacing = getSliceSpacing((float) Ts);
+		tableSlicePosition = (float) ((std::log(coefficients.G) - spacing.start) / spacing.step);
+	}
+
+	// Moves a gliding component numSamples along, returning which
+	// coefficients that invalidates
+	static uint32_t advanceComponent(SampleType& component, SmoothedComponent& smoothed, size_t numSamples, ComponentChanges change)
+	{
+		if (! smoothed.isSmoothing())
+			return 0;
+
+		component = smoothed.skip((int) numSamples);
+		return change;
 	}
 
 	//==============================================================================
@@ -8,6 +8,17 @@ namespace ID
 	PARAMETER_ID(distInputGain)
 	PARAMETER_ID(distCompGain)
 	PARAMETER_ID(outputGain)
+	PARAMETER_ID(circuitModel)
+	PARAMETER_ID(solverMode)
+	PARAMETER_ID(oversamplingFactor)
+	PARAMETER_ID(oversamplingFilter)
+	PARAMETER_ID(adaptiveQuality)
+	PARAMETER_ID(cpuBudget)
+	PARAMETER_ID(solverPrecision)
+	PARAMETER_ID(c1)
+	PARAMETER_ID(r4)
+	PARAMETER_ID(c2)
+	PARAMETER_ID(drive)
 
 	#undef PARAMETER_ID
 }
\ No newline at end of file
@@ -50,6 +50,14 @@ struct ParameterReferences
 		return getBasicAttributes().withLabel("dB");
 	}
 
+	// A component value's range, skewed so the default sits at the centre
+	static juce::NormalisableRange<float> getComponentRange(float start, float end, float centre)
+	{
+		juce::NormalisableRange<float> range(start, end);
+		range.setSkewForCentre(centre);
+		return range;
+	}
+
 	struct MainGroup
 	{
 		MainGroup(juce::AudioProcessorParameterGroup& layout)
@@ -80,19 +88,112 @@ struct ParameterReferences
 			  	"Output",
 			  	juce::NormalisableRange<float>(-60.0f, 0.0f),
 			  	0.0f,
-			  	getDbAttributes()))
+			  	getDbAttributes())),
+			  circuitModel(addToLayout<juce::AudioParameterChoice>(
+			  	layout,
+			  	juce::ParameterID { ID::circuitModel, 1 },
+			  	"Circuit Model",
+			  	juce::StringArray { "Nodal Analysis", "Wave Digital Filter", "Symmetric Diode Clipper", "Asymmetric Diode Clipper",
+			  	                    "ADAA (1st Order)", "ADAA (2nd Order)" },
+			  	0)),
+			  solverMode(addToLayout<juce::AudioParameterChoice>(
+			  	layout,
+			  	juce::ParameterID { ID::solverMode, 1 },
+			  	"Solver",
+			  	juce::StringArray { "Newton-Raphson", "Lookup Table" },
+			  	0)),
+			  oversamplingFactor(addToLayout<juce::AudioParameterChoice>(
+			  	layout,
+			  	juce::ParameterID { ID::oversamplingFactor, 1 },
+			  	"Oversampling",
+			  	juce::StringArray { "1x", "2x", "4x", "8x", "16x" },
+			  	2)),
+			  oversamplingFilter(addToLayout<juce::AudioParameterChoice>(
+			  	layout,
+			  	juce::ParameterID { ID::oversamplingFilter, 1 },
+			  	"Oversampling Filter",
+			  	juce::StringArray { "IIR", "Linear Phase FIR", "Low Latency IIR" },
+			  	0)),
+			  adaptiveQuality(addToLayout<juce::AudioParameterBool>(
+			  	layout,
+			  	juce::ParameterID { ID::adaptiveQuality, 1 },
+			  	"Adaptive Quality",
+			  	false)),
+			  cpuBudget(addToLayout<Parameter>(
+			  	layout,
+			  	juce::ParameterID { ID::cpuBudget, 1 },
+			  	"CPU Budget",
+			  	juce::NormalisableRange<float>(5.0f, 100.0f),
+			  	25.0f,
+			  	getBasicAttributes().withLabel("%"))),
+			  solverPrecision(addToLayout<juce::AudioParameterChoice>(
+			  	layout,
+			  	juce::ParameterID { ID::solverPrecision, 1 },
+			  	"Solver Precision",
+			  	juce::StringArray { "Single", "Mixed (Double Solver)" },
+			  	0))
 		{}
 
 		Parameter& inputGain;
 		Parameter& distInputGain;
 		Parameter& distCompGain;
 		Parameter& outputGain;
+		juce::AudioParameterChoice& circuitModel;
+		juce::AudioParameterChoice& solverMode;
+		juce::AudioParameterChoice& oversamplingFactor;
+		juce::AudioParameterChoice& oversamplingFilter;
+		juce::AudioParameterBool& adaptiveQuality;
+		Parameter& cpuBudget;
+		juce::AudioParameterChoice& solverPrecision;
+
+	};
+
+	// The nodal analysis circuit's components. The other circuits keep the
+	// defaults.
+	struct CircuitGroup
+	{
+		CircuitGroup(juce::AudioProcessorParameterGroup& layout)
+			: c1(addToLayout<Parameter>(
+				layout,
+				juce::ParameterID { ID::c1, 1 },
+				"C1",
+				getComponentRange(10.0f, 220.0f, 47.0f),
+				47.0f,
+				getBasicAttributes().withLabel("nF"))),
+			  r4(addToLayout<Parameter>(
+			  	layout,
+			  	juce::ParameterID { ID::r4, 1 },
+			  	"R4",
+			  	getComponentRange(1000.0f, 22000.0f, 4700.0f),
+			  	4700.0f,
+			  	getBasicAttributes().withLabel("Ohm"))),
+			  c2(addToLayout<Parameter>(
+			  	layout,
+			  	juce::ParameterID { ID::c2, 1 },
+			  	"C2",
+			  	getComponentRange(10.0f, 1000.0f, 51.0f),
+			  	51.0f,
+			  	getBasicAttributes().withLabel("pF"))),
+			  drive(addToLayout<Parameter>(
+			  	layout,
+			  	juce::ParameterID { ID::drive, 1 },
+			  	"Drive (R3)",
+			  	juce::NormalisableRange<float>(0.0f, 500.0f),
+			  	500.0f,
+			  	getBasicAttributes().withLabel("kOhm")))
+		{}
 
+		Parameter& c1;
+		Parameter& r4;
+		Parameter& c2;
+		Parameter& drive;
 	};
 
 	ParameterReferences(juce::AudioProcessorValueTreeState::ParameterLayout& layout)
-		: main(addToLayout<juce::AudioProcessorParameterGroup>(layout, "main", "Main", "|"))
+		: main(addToLayout<juce::AudioProcessorParameterGroup>(layout, "main", "Main", "|")),
+		  circuit(addToLayout<juce::AudioProcessorParameterGroup>(layout, "circuit", "Circuit", "|"))
 	{}
 
 	MainGroup main;
+	CircuitGroup circuit;
 };
\ No newline at end of file
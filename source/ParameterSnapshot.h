@@ -0,0 +1,59 @@
+#pragma once
+
+// Reads the parameters' atomics on the audio thread and flags the ones that
+// changed since the last read, so only their dependents are recomputed. It
+// takes no locks and never allocates, and unlike a shared "needs update" flag
+// a change that lands while the previous one is being applied is picked up by
+// the next read instead of being lost.
+template <size_t NumParameters>
+class ParameterSnapshot
+{
+public:
+	static_assert (NumParameters <= 32, "Dirty flags are held in 32 bits");
+
+	ParameterSnapshot(juce::AudioProcessorValueTreeState& state, const std::array<const char*, NumParameters>& parameterIds)
+	{
+		for (size_t i = 0; i < NumParameters; ++i)
+		{
+			sources[i] = state.getRawParameterValue(parameterIds[i]);
+			jassert (sources[i] != nullptr);
+		}
+	}
+
+	~ParameterSnapshot() {}
+
+	// Takes a new snapshot and returns a mask with bit i set for every
+	// parameter i that changed. The first read, and the first after
+	// markAllDirty(), reports every parameter.
+	uint32_t read()
+	{
+		uint32_t dirty = 0;
+
+		for (size_t i = 0; i < NumParameters; ++i)
+		{
+			const float value = sources[i]->load(std::memory_order_relaxed);
+
+			if (value != values[i] || allDirty)
+			{
+				values[i] = value;
+				dirty |= 1u << i;
+			}
+		}
+
+		allDirty = false;
+		return dirty;
+	}
+
+	void markAllDirty() { allDirty = true; }
+
+	float operator[](size_t index) const { return values[index]; }
+
+	static bool isDirty(uint32_t dirty, size_t index) { return (dirty & (1u << index)) != 0; }
+
+private:
+	std::array<std::atomic<float>*, NumParameters> sources {};
+	std::array<float, NumParameters> values {};
+	bool allDirty = true;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterSnapshot)
+};
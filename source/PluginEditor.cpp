@@ -6,6 +6,11 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
     : AudioProcessorEditor (&p), processorRef (p)
 {
     juce::ignoreUnused (processorRef);
+
+   #if SYN_SOLVER_STATS
+    processorRef.getMetricsPublisher().onUpdate = [this] { repaint(); };
+   #endif
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
     setSize (400, 300);
@@ -13,6 +18,9 @@ AudioPluginAudioProcessorEditor::AudioPluginAudioProcessorEditor (AudioPluginAud
 
 AudioPluginAudioProcessorEditor::~AudioPluginAudioProcessorEditor()
 {
+   #if SYN_SOLVER_STATS
+    processorRef.getMetricsPublisher().onUpdate = nullptr;
+   #endif
 }
 
 //==============================================================================
@@ -23,7 +31,24 @@ void AudioPluginAudioProcessorEditor::paint (juce::Graphics& g)
 
     g.setColour (juce::Colours::white);
     g.setFont (15.0f);
+
+   #if SYN_SOLVER_STATS
+    const auto& totals = processorRef.getMetricsPublisher().getTotals();
+    const auto& latest = totals.latest;
+
+    juce::StringArray lines;
+    lines.add ("Iterations per block: " + juce::String (latest.iterations));
+    lines.add ("Max iterations: " + juce::String (latest.maxIterations) + " (session " + juce::String (totals.maxIterations) + ")");
+    lines.add ("Cap hits: " + juce::String (latest.capHits) + " (session " + juce::String ((juce::int64) totals.capHits) + ")");
+    lines.add ("Average iterations: " + juce::String (totals.solves > 0 ? (double) totals.iterations / (double) totals.solves : 0.0, 2));
+    lines.add ("CPU load: " + juce::String (latest.load * 100.0f, 1) + "% (peak " + juce::String (totals.peakLoad * 100.0f, 1) + "%)");
+    lines.add ("Quality: " + juce::String (QualityGovernor::getLevelName ((QualityGovernor::Level) latest.qualityLevel))
+               + " (" + juce::String ((juce::int64) totals.qualityChanges) + " changes)");
+
+    g.drawFittedText (lines.joinIntoString ("\n"), getLocalBounds().reduced (20), juce::Justification::centredLeft, lines.size());
+   #else
     g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
+   #endif
 }
 
 void AudioPluginAudioProcessorEditor::resized()
@@ -23,7 +23,6 @@ AudioPluginAudioProcessor::AudioPluginAudioProcessor(juce::AudioProcessorValueTr
        parameters { layout },
        apvts { *this, nullptr, "state", std::move(layout) }
 {
-    apvts.state.addListener (this);
 }
 
 //==============================================================================
@@ -61,7 +60,8 @@ bool AudioPluginAudioProcessor::isMidiEffect() const
 
 double AudioPluginAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return isUsingDoublePrecision() ? doubleProcessor.getTailLengthSeconds()
+                                    : floatProcessor.getTailLengthSeconds();
 }
 
 int AudioPluginAudioProcessor::getNumPrograms()
@@ -105,29 +105,152 @@ void AudioPluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPer
         return;
     }
 
-    chain.prepare({ sampleRate, (juce::uint32) samplesPerBlock, (juce::uint32) channels });
-    reset();
+    if (isUsingDoublePrecision())
+        prepare<double> (sampleRate, samplesPerBlock, channels);
+    else
+        prepare<float> (sampleRate, samplesPerBlock, channels);
+
+    loadMeasurer.reset (sampleRate, samplesPerBlock);
+}
+
+template <typename SampleType>
+void AudioPluginAudioProcessor::prepare (double sampleRate, int samplesPerBlock, int numChannels)
+{
+    auto& distortionProcessor = getDistortionProcessor<SampleType>();
+
+    // The circuit only prepares its lookup tables if the table solver or the
+    // governor, which may switch to it, is on. Otherwise the table builder
+    // fetches them if one is switched on later.
+    snapshot.read();
+    applyComponents<SampleType>();
+    governor.reset();
+    applyQuality<SampleType>();
+
+    distortionProcessor.prepare({ sampleRate, (juce::uint32) samplesPerBlock, (juce::uint32) numChannels });
+    getTableBuilder<SampleType>().prepare(distortionProcessor.getCircuitSampleRates(),
+                                          distortionProcessor.distortion.template get<NonInvertingOpAmpClipper<SampleType>>());
+    resetProcessing<SampleType>();
 }
 
 void AudioPluginAudioProcessor::reset()
 {
-    chain.reset();
-    update();
+    if (isUsingDoublePrecision())
+        resetProcessing<double>();
+    else
+        resetProcessing<float>();
 }
 
-void AudioPluginAudioProcessor::update()
+template <typename SampleType>
+void AudioPluginAudioProcessor::resetProcessing()
 {
-    {
-        DistortionProcessor& distortionProcessor = juce::dsp::get<distortionProcessorIndex>(chain);
+    // Every parameter is applied before the processor resets, so the gains
+    // start at their values rather than ramping towards them
+    snapshot.markAllDirty();
+    update<SampleType>(snapshot.read());
+    getDistortionProcessor<SampleType>().reset();
+}
+
+template <typename SampleType>
+void AudioPluginAudioProcessor::update(uint32_t dirty)
+{
+    using Distortion = DistortionProcessor<SampleType>;
+    using Nodal = NonInvertingOpAmpClipper<SampleType>;
+
+    if (dirty == 0)
+        return;
+
+    auto& distortionProcessor = getDistortionProcessor<SampleType>();
+    const auto isDirty = [dirty](SnapshotIndices index) { return Snapshot::isDirty(dirty, index); };
+
+    if (isDirty(inputGainValue))
+        distortionProcessor.setGainDecibels(Distortion::inputGain, snapshot[inputGainValue]);
+
+    if (isDirty(distInputGainValue))
+        distortionProcessor.setGainDecibels(Distortion::distInputGain, snapshot[distInputGainValue]);
+
+    if (isDirty(distCompGainValue))
+        distortionProcessor.setGainDecibels(Distortion::distCompGain, snapshot[distCompGainValue]);
+
+    if (isDirty(outputGainValue))
+        distortionProcessor.setGainDecibels(Distortion::outputGain, snapshot[outputGainValue]);
+
+    if (isDirty(circuitModelValue))
+        distortionProcessor.setCircuit((size_t) snapshot[circuitModelValue]);
+
+    if (isDirty(adaptiveQualityValue))
+        governor.reset();
+
+    if (isDirty(solverPrecisionValue))
+        distortionProcessor.distortion.template get<Nodal>()
+            .setSolverPrecision((typename Nodal::SolverPrecision) (int) snapshot[solverPrecisionValue]);
 
-        distortionProcessor.distInputGain.setGainDecibels(parameters.main.distInputGain.get());
-        distortionProcessor.distCompGain.setGainDecibels(parameters.main.distCompGain.get());
+    if (isDirty(solverModeValue) || isDirty(adaptiveQualityValue))
+        applyQuality<SampleType>();
+
+    // The circuit recomputes its coefficients when it next runs, and the
+    // tail follows its time constants
+    if (isDirty(c1Value) || isDirty(r4Value) || isDirty(c2Value) || isDirty(driveValue))
+    {
+        applyComponents<SampleType>();
+        distortionProcessor.updateTailLength();
     }
 
-    juce::dsp::get<inputGainIndex>(chain).setGainDecibels(parameters.main.inputGain.get());
-    juce::dsp::get<outputGainIndex>(chain).setGainDecibels(parameters.main.outputGain.get());
+    if (isDirty(oversamplingFactorValue) || isDirty(oversamplingFilterValue))
+        distortionProcessor.setOversampling((size_t) snapshot[oversamplingFactorValue],
+                                            (typename Distortion::OversamplingFilter) (int) snapshot[oversamplingFilterValue]);
+
+    // Some circuits delay their output too
+    if (isDirty(oversamplingFactorValue) || isDirty(oversamplingFilterValue) || isDirty(circuitModelValue))
+        setLatencySamples(distortionProcessor.getLatencyInSamples());
+}
+
+template <typename SampleType>
+void AudioPluginAudioProcessor::applyComponents()
+{
+    auto& nodal = getDistortionProcessor<SampleType>().distortion.template get<NonInvertingOpAmpClipper<SampleType>>();
+
+    nodal.setC1(snapshot[c1Value] * 1e-9f);
+    nodal.setR4(snapshot[r4Value]);
+    nodal.setC2(snapshot[c2Value] * 1e-12f);
+    nodal.setDrive(snapshot[driveValue] * 1000.f);
+}
+
+template <typename SampleType>
+void AudioPluginAudioProcessor::applyQuality()
+{
+    using Nodal = NonInvertingOpAmpClipper<SampleType>;
+
+    auto& clippers = getDistortionProcessor<SampleType>().distortion;
+    auto& nodal = clippers.template get<Nodal>();
+
+    const auto level = governor.getLevel();
+    const auto cap = level >= QualityGovernor::reducedIterations ? QualityGovernor::reducedIterationCap
+                                                                 : Nodal::defaultMaxIterations;
+
+    clippers.forEach([cap](auto& clipper) { clipper.setMaxIterations(cap); });
+
+    // The nodal solver's default guess can take 25 iterations on fast edges,
+    // so capping it alone is audible. From the explicit estimate it converges
+    // within 4, and the capped output stays within -110 dB of the full one.
+    nodal.setPredictor(level >= QualityGovernor::reducedIterations ? Nodal::Predictor::explicitEstimate
+                                                                   : Nodal::Predictor::previousSample);
+
+    // Only the nodal circuit has a table, so the others stay at the reduced
+    // cap on the last level. The tables for every rate are built in
+    // prepareToPlay if either needs them, so turning the governor on, which
+    // keeps the table loaded, and switching to the table only look one up.
+    // If prepareToPlay skipped them, the table builder fetches them in the
+    // background. Neither builds them here on the audio thread.
+    auto mode = (typename Nodal::SolverMode) (int) snapshot[solverModeValue];
+
+    if (level >= QualityGovernor::tableSolver)
+        mode = Nodal::SolverMode::lookupTable;
+
+    nodal.setKeepTableReady(snapshot[adaptiveQualityValue] >= 0.5f);
+    nodal.setSolverMode(mode);
 
-    requiresUpdate.store(false);
+    if (nodal.isMissingTables())
+        getTableBuilder<SampleType>().request();
 }
 
 void AudioPluginAudioProcessor::releaseResources()
@@ -142,12 +265,11 @@ bool AudioPluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel has its own circuit state, so any layout works up to
+    // the clipper's channel capacity (7.1.4).
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+
+    if (mainOutput.isDisabled() || (size_t) mainOutput.size() > NonInvertingOpAmpClipper<float>::maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -164,27 +286,115 @@ void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
     juce::ignoreUnused (midiMessages);
+    process (buffer);
+}
+
+void AudioPluginAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer,
+                                              juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+    process (buffer);
+}
+
+bool AudioPluginAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void AudioPluginAudioProcessor::process (juce::AudioBuffer<SampleType>& buffer)
+{
     juce::ScopedNoDenormals noDenormals;
 
-    if (requiresUpdate.load())
+    juce::AudioProcessLoadMeasurer::ScopedTimer loadTimer (loadMeasurer, buffer.getNumSamples());
+
+    auto& distortionProcessor = getDistortionProcessor<SampleType>();
+    auto& nodal = distortionProcessor.distortion.template get<NonInvertingOpAmpClipper<SampleType>>();
+
+    const auto restores = stateRestores.load (std::memory_order_acquire);
+
+    if ((restores & 1) == 0)
+    {
+        const auto dirty = snapshot.read();
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        // A restore that started during the read is applied in full once
+        // it's done
+        if (stateRestores.load (std::memory_order_relaxed) == restores)
+            update<SampleType>(dirty);
+        else
+            snapshot.markAllDirty();
+    }
+
+    // The load is the smoothed measurement up to the previous block, and the
+    // budget is this instance's share of each block's real-time duration.
+    // The nodal circuit's table strays from its iterative solver by up to
+    // 5e-5 V on the odd sample, so it crossfades from the old solver to the
+    // new one over a sub-block rather than stepping. The other circuits
+    // converge well within the reduced cap, so theirs doesn't change.
+    if (snapshot[adaptiveQualityValue] >= 0.5f)
     {
-        update();
+        governor.setBudget (snapshot[cpuBudgetValue] * 0.01f);
+
+        if (governor.update ((float) loadMeasurer.getLoadAsProportion()))
+        {
+            nodal.beginSolverFade (distortionProcessor.getCircuitSubBlockSize());
+            applyQuality<SampleType>();
+        }
     }
-    
+
+    // Tables fetched in the background since applyQuality() asked for them
+    getTableBuilder<SampleType>().deliver (nodal);
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    auto inOutBlock = juce::dsp::AudioBlock<float>(buffer);
-    chain.process(juce::dsp::ProcessContextReplacing<float>(inOutBlock));
+    auto inOutBlock = juce::dsp::AudioBlock<SampleType>(buffer);
+    juce::dsp::ProcessContextReplacing<SampleType> context (inOutBlock);
+    distortionProcessor.process(context);
+
+   #if SYN_SOLVER_STATS
+    publishMetrics<SampleType> ((juce::uint32) buffer.getNumSamples());
+   #endif
 }
 
+#if SYN_SOLVER_STATS
+template <typename SampleType>
+void AudioPluginAudioProcessor::publishMetrics (juce::uint32 numSamples)
+{
+    // The load measured here lags by one block, since the scoped timer in
+    // processBlock only finishes after this call
+    // Only the active circuit runs, so its counters are the block's
+    auto& clipper = getDistortionProcessor<SampleType>().distortion;
+    const auto& stats = clipper.getSolverStats();
+
+    BlockMetrics metrics;
+    metrics.numSamples = numSamples;
+    metrics.solves = (juce::uint32) stats.solves;
+    metrics.iterations = (juce::uint32) stats.iterations;
+    metrics.maxIterations = stats.maxIterations;
+    metrics.capHits = (juce::uint32) stats.capHits;
+    metrics.load = (float) loadMeasurer.getLoadAsProportion();
+    metrics.qualityLevel = (juce::uint32) governor.getLevel();
+
+    metricsFifo.push (metrics);
+    clipper.resetSolverStats();
+}
+#endif
+
 //==============================================================================
 bool AudioPluginAudioProcessor::hasEditor() const
 {
-    return false; // (change this to false if you choose to not supply an editor)
+    // The editor only shows the solver metrics, so without them the host's
+    // generic editor is more useful
+   #if SYN_SOLVER_STATS
+    return true;
+   #else
+    return false;
+   #endif
 }
 
 juce::AudioProcessorEditor* AudioPluginAudioProcessor::createEditor()
@@ -195,22 +405,20 @@ juce::AudioProcessorEditor* AudioPluginAudioProcessor::createEditor()
 //==============================================================================
 void AudioPluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    juce::ignoreUnused (destData);
+    stateSerializer.write (destData);
 }
 
 void AudioPluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    juce::ignoreUnused (data, sizeInBytes);
-}
+    stateRestores.fetch_add (1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
 
-void AudioPluginAudioProcessor::valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&)
-{
-    requiresUpdate.store(true);
+    const auto restored = stateSerializer.read (data, sizeInBytes);
+    stateRestores.fetch_add (1, std::memory_order_release);
+
+    // Unrecognised data is most likely from a newer version of the plugin
+    jassert (restored || sizeInBytes == 0);
+    juce::ignoreUnused (restored);
 }
 
 //==============================================================================
@@ -3,10 +3,21 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 #include "ParameterReferences.h"
+#include "ClipperSelector.h"
+#include "ADAAClipper.h"
+#include "DKClipper.h"
+#include "Netlists.h"
 #include "NonInvertingOpAmpClipper.h"
+#include "WDFOpAmpClipper.h"
+#include "Instrumentation.h"
+#include "ParameterSnapshot.h"
+#include "SharedResourceCache.h"
+#include "QualityGovernor.h"
+#include "TableBuilder.h"
+#include "StateSerializer.h"
 
 //==============================================================================
-class AudioPluginAudioProcessor  : public juce::AudioProcessor, private juce::ValueTree::Listener
+class AudioPluginAudioProcessor  : public juce::AudioProcessor
 {
 public:
     //==============================================================================
@@ -23,7 +34,9 @@ public:
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-    using AudioProcessor::processBlock;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -48,65 +61,560 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-private:
-    void update();
-    void valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&) override;
-    
+    //==============================================================================
+    // Gain changes are ramped over this long to avoid zipper noise
+    static constexpr double gainRampSeconds = 0.02;
+
+    // Indices match the circuitModel parameter's choices
+    template <typename SampleType>
+    using Clippers = ClipperSelector<NonInvertingOpAmpClipper<SampleType>,
+                                     WDFOpAmpClipper<SampleType>,
+                                     DKClipper<Netlists::SymmetricDiodeClipper, SampleType>,
+                                     DKClipper<Netlists::AsymmetricDiodeClipper, SampleType>,
+                                     ADAAClipper<1, SampleType>,
+                                     ADAAClipper<2, SampleType>>;
+
+    // The input and output gains are applied with the distortion's own gains
+    // as one ramp each side of the circuit. Without oversampling they are
+    // applied inside the circuit's loop, otherwise to each sub-block on its
+    // way into and out of the oversampler, while it is in cache.
+    //
+    // SampleType is the host's processing precision. Everything from the
+    // gains to the circuit's states runs in it, except the nodal circuit's
+    // lookup table, which is float either way.
+    template <typename SampleType>
     struct DistortionProcessor
     {
         DistortionProcessor() {}
         ~DistortionProcessor() {}
 
+        enum GainStage
+        {
+            inputGain,
+            distInputGain,
+            distCompGain,
+            outputGain,
+            numGainStages
+        };
+
+        using Oversampling = juce::dsp::Oversampling<SampleType>;
+
+        // Oversampling orders 0 to 4, i.e. 1x to 16x
+        static constexpr size_t maxOversamplingOrder = 4;
+
+        // The low latency IIR has wider transitions and less stopband
+        // rejection than the default IIR, and less delay
+        enum OversamplingFilter
+        {
+            iirFilter,
+            firFilter,
+            iirLowLatencyFilter,
+            numOversamplingFilters
+        };
+
+        // Blocks are processed through the oversampler and the circuit in
+        // pieces of at most this many samples, so host blocks of any size
+        // fit the buffers prepared for them
+        static constexpr size_t defaultSubBlockSize = 512;
+
+        // Input and circuit states below this (-100 dBFS) count as silence.
+        // The nodal solver can settle a few uV away from zero, so the gate
+        // doesn't go much lower.
+        static constexpr float silenceThreshold = 1e-5f;
+
+        // Decay of the circuit from full scale states to the threshold
+        static constexpr float circuitTailTimeConstants = 20.f;
+
+        // An oversampler's tail at one sample rate, shared by every instance
+        struct TailKey
+        {
+            double sampleRate;
+            size_t filter;
+            size_t order;
+
+            bool operator== (const TailKey& other) const
+            {
+                return sampleRate == other.sampleRate && filter == other.filter && order == other.order;
+            }
+        };
+
+        using TailCache = SharedResourceCache<TailKey, int>;
+
+        // Takes effect on the next prepare
+        void setSubBlockSize (size_t newSize)
+        {
+            maxSubBlockSize = juce::jmax((size_t) 1, newSize);
+        }
+
+        void setGainDecibels (GainStage stage, float decibels)
+        {
+            gains[stage].setTargetValue(juce::Decibels::decibelsToGain((SampleType) decibels));
+        }
+
         void prepare (const juce::dsp::ProcessSpec& spec) {
-            oversampler.initProcessing(spec.maximumBlockSize);
+            sampleRate = spec.sampleRate;
+            subBlockSize = juce::jmin(maxSubBlockSize, (size_t) juce::jmax((juce::uint32) 1, spec.maximumBlockSize));
+
+            preGains.resize(subBlockSize);
+            postGains.resize(subBlockSize);
+            resetGains();
+
+            // Every factor and filter type is built up front, so switching
+            // between them on the audio thread never allocates. The filter
+            // designs don't depend on the sample rate, so they are only built
+            // again when the channel count, which follows the bus layout,
+            // changes. JUCE keeps the coefficients inside each instance, so
+            // unlike the tails they can't be shared between plugin instances.
+            // The IIR filters' fractional delay is padded to a whole sample,
+            // so the reported latency is exact.
+            const bool channelsChanged = spec.numChannels != oversamplerChannels;
+            oversamplerChannels = spec.numChannels;
+
+            for (size_t filter = 0; filter < numOversamplingFilters; ++filter)
+            {
+                const auto type = filter == firFilter ? Oversampling::filterHalfBandFIREquiripple
+                                                      : Oversampling::filterHalfBandPolyphaseIIR;
 
-            distortion.reset(oversampler.getOversamplingFactor() * (float) spec.sampleRate);
+                for (size_t order = 1; order <= maxOversamplingOrder; ++order)
+                {
+                    auto& instance = oversamplers[filter][order - 1];
+
+                    if (instance == nullptr || channelsChanged)
+                    {
+                        instance = std::make_unique<Oversampling>(spec.numChannels, order, type, filter != iirLowLatencyFilter, true);
+                        instance->setUsingIntegerLatency(true);
+                    }
+
+                    instance->initProcessing(subBlockSize);
+
+                    oversamplerTails[filter][order - 1] = TailCache::getInstance().get({ sampleRate, filter, order },
+                                                                                       [this, &instance, &spec] { return measureTail(*instance, spec.numChannels, subBlockSize, sampleRate); });
+                }
+            }
+
+            distortion.prepareSampleRates(getCircuitSampleRates());
+
+            circuitDelay.prepare(spec);
+
+            selectOversampler();
         }
 
         void reset() {
-            oversampler.reset();
+            resetGains();
+
+            if (oversampler != nullptr)
+                oversampler->reset();
+
+            circuitDelay.reset();
+
+            silentSamples = 0;
+            asleep = false;
         }
 
+        // Indices follow the list of Clippers
+        void setCircuit(size_t index)
+        {
+            if (index == distortion.getIndex())
+                return;
+
+            distortion.setIndex(index);
+            updateCircuitPadding();
+            updateTailLength();
+        }
+
+        void setOversampling(size_t newOrder, OversamplingFilter newFilter)
+        {
+            newOrder = juce::jmin(newOrder, maxOversamplingOrder);
+
+            if (newOrder == oversamplingOrder && newFilter == oversamplingFilter)
+                return;
+
+            oversamplingOrder = newOrder;
+            oversamplingFilter = newFilter;
+            selectOversampler();
+        }
+
+        void selectOversampler()
+        {
+            oversampler = oversamplingOrder > 0 ? oversamplers[oversamplingFilter][oversamplingOrder - 1].get() : nullptr;
+
+            if (oversampler != nullptr)
+                oversampler->reset();
+
+            distortion.reset(getCircuitSampleRate(oversamplingOrder));
+            updateCircuitPadding();
+            updateTailLength();
+        }
+
+        // The circuit's own delay is at the oversampled rate, so it is only a
+        // whole number of samples for some circuits and factors. It is padded
+        // to the next whole sample with a fractional delay, as the oversampler
+        // pads its IIR filters, which keeps the interpolator between 0.618 and
+        // 1.618 samples of delay where it is accurate.
+        void updateCircuitPadding()
+        {
+            const auto circuitLatency = (double) distortion.getLatency() / (double) (1 << oversamplingOrder);
+            auto padding = std::ceil(circuitLatency) - circuitLatency;
+
+            if (padding > 0.0 && padding < 0.618)
+                padding += 1.0;
+
+            if (padding != (double) circuitPadding)
+            {
+                circuitPadding = (float) padding;
+                circuitDelay.setDelay(circuitPadding);
+                circuitDelay.reset();
+            }
+        }
+
+        // Called when the oversampler or the circuit's time constant changes
+        void updateTailLength()
+        {
+            const auto filterTail = oversampler != nullptr ? *oversamplerTails[oversamplingFilter][oversamplingOrder - 1] : 0;
+            const auto circuitTail = (int) std::ceil(circuitTailTimeConstants * distortion.getTimeConstant() * sampleRate);
+            const auto paddingTail = (int) std::ceil(circuitPadding);
+
+            tailSamples = (size_t) (filterTail + circuitTail + paddingTail);
+            tailSeconds.store((double) tailSamples / sampleRate);
+        }
+
+        float getCircuitSampleRate(size_t order) const
+        {
+            return (float) (sampleRate * (double) (1 << order));
+        }
+
+        // Every rate the circuit may run at, one per oversampling order
+        std::vector<float> getCircuitSampleRates() const
+        {
+            std::vector<float> rates;
+
+            for (size_t order = 0; order <= maxOversamplingOrder; ++order)
+                rates.push_back(getCircuitSampleRate(order));
+
+            return rates;
+        }
+
+        // The samples the circuit runs per sub-block at the current oversampling
+        size_t getCircuitSubBlockSize() const
+        {
+            return subBlockSize << oversamplingOrder;
+        }
+
+        // A whole number of samples, with the circuit's delay padded by
+        // updateCircuitPadding
+        int getLatencyInSamples()
+        {
+            const auto filterLatency = oversampler != nullptr ? (double) oversampler->getLatencyInSamples() : 0.0;
+            const auto circuitLatency = (double) distortion.getLatency() / (double) (1 << oversamplingOrder);
+
+            return (int) std::round(filterLatency + circuitLatency + (double) circuitPadding);
+        }
+
+        // Safe to call from any thread
+        double getTailLengthSeconds() const { return tailSeconds.load(); }
+
         template <typename Context>
         void process (Context& context)
         {
             if (context.isBypassed)
                 return;
 
-            const auto& inputBlock = context.getInputBlock();
+            // Silence gate. Once the input has been silent for the whole tail
+            // and the circuit has settled, blocks are cleared without running
+            // the oversampler or the solver. The states are cleared on the way
+            // to sleep, so the next sound starts from rest.
+            const auto numSamples = context.getInputBlock().getNumSamples();
+            const auto inputRange = context.getInputBlock().findMinAndMax();
+            const auto inputPeak = juce::jmax(std::abs(inputRange.getStart()), std::abs(inputRange.getEnd()));
+
+            if (inputPeak * gains[inputGain].getTargetValue() * gains[distInputGain].getTargetValue() < silenceThreshold)
+            {
+                if (asleep)
+                {
+                    for (auto& gain : gains)
+                        gain.skip((int) numSamples);
+
+                    context.getOutputBlock().clear();
+                    return;
+                }
+
+                silentSamples += numSamples;
+            }
+            else
+            {
+                silentSamples = 0;
+                asleep = false;
+            }
+
+            // The oversampler only takes blocks up to the size it was
+            // prepared for
+            auto&& inputBlock = context.getInputBlock();
+            auto&& outputBlock = context.getOutputBlock();
+
+            for (size_t start = 0; start < numSamples; start += subBlockSize)
+            {
+                const auto length = juce::jmin(subBlockSize, numSamples - start);
+                auto subBlock = outputBlock.getSubBlock(start, length);
+
+                const ClipperGains<SampleType> subBlockGains { preGains.data(), postGains.data() };
+                fillGains(preGains.data(), gains[inputGain], gains[distInputGain], length);
+                fillGains(postGains.data(), gains[distCompGain], gains[outputGain], length);
+
+                if (oversampler == nullptr)
+                {
+                    if constexpr (Context::usesSeparateInputAndOutputBlocks())
+                    {
+                        juce::dsp::ProcessContextNonReplacing<SampleType> distortionContext (inputBlock.getSubBlock(start, length), subBlock);
+                        distortion.process(distortionContext, subBlockGains);
+                    }
+                    else
+                    {
+                        juce::dsp::ProcessContextReplacing<SampleType> distortionContext (subBlock);
+                        distortion.process(distortionContext, subBlockGains);
+                    }
+                }
+                else
+                {
+                    applyGains(inputBlock.getSubBlock(start, length), subBlock, preGains.data());
+
+                    auto ovBlock = oversampler->processSamplesUp(subBlock);
+                    juce::dsp::ProcessContextReplacing<SampleType> distortionContext (ovBlock);
+
+                    distortion.process(distortionContext);
+
+                    oversampler->processSamplesDown(subBlock);
+                    applyGains(subBlock, subBlock, postGains.data());
+                }
+
+                if (circuitPadding > 0.f)
+                    padCircuitLatency(subBlock);
+            }
+
+            if (silentSamples >= tailSamples && distortion.isQuiescent(silenceThreshold))
+            {
+                asleep = true;
+                distortion.clearState();
+
+                if (oversampler != nullptr)
+                    oversampler->reset();
+
+                circuitDelay.reset();
+            }
+        }
+
+        void padCircuitLatency(juce::dsp::AudioBlock<SampleType>& block)
+        {
+            for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+            {
+                auto* samples = block.getChannelPointer(channel);
+
+                for (size_t i = 0; i < block.getNumSamples(); ++i)
+                {
+                    circuitDelay.pushSample((int) channel, samples[i]);
+                    samples[i] = circuitDelay.popSample((int) channel);
+                }
+            }
+        }
+
+        // Samples until an impulse through the oversampler's filters has
+        // decayed below the silence threshold, at the base rate
+        static int measureTail(Oversampling& instance, juce::uint32 numChannels, size_t blockSize, double rate)
+        {
+            juce::AudioBuffer<SampleType> buffer ((int) numChannels, (int) blockSize);
+            juce::dsp::AudioBlock<SampleType> block (buffer);
+
+            const auto latency = (int) std::ceil(instance.getLatencyInSamples());
+            int tail = 0;
+
+            instance.reset();
+
+            for (int start = 0; start < (int) rate; start += buffer.getNumSamples())
+            {
+                buffer.clear();
+
+                if (start == 0)
+                    buffer.setSample(0, 0, (SampleType) 1);
+
+                instance.processSamplesUp(block);
+                instance.processSamplesDown(block);
+
+                bool audible = false;
+
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                {
+                    if (std::abs(buffer.getSample(0, i)) >= (SampleType) silenceThreshold)
+                    {
+                        tail = start + i + 1;
+                        audible = true;
+                    }
+                }
+
+                if (! audible && start > latency)
+                    break;
+            }
 
-            distInputGain.process(context);
+            instance.reset();
+            return tail;
+        }
 
-            auto ovBlock = oversampler.processSamplesUp(inputBlock);
-            juce::dsp::ProcessContextReplacing<float> distortionContext (ovBlock);
+        void resetGains()
+        {
+            for (auto& gain : gains)
+                gain.reset(sampleRate, gainRampSeconds);
+        }
 
-            distortion.process(context);
+        // The product of two ramps, or a constant once both have settled
+        static void fillGains(SampleType* dest, juce::SmoothedValue<SampleType>& a, juce::SmoothedValue<SampleType>& b, size_t numSamples)
+        {
+            if (! a.isSmoothing() && ! b.isSmoothing())
+            {
+                juce::FloatVectorOperations::fill(dest, a.getTargetValue() * b.getTargetValue(), (int) numSamples);
+                return;
+            }
 
-            auto& outputBlock = context.getOutputBlock();
-            oversampler.processSamplesDown(outputBlock);
+            for (size_t i = 0; i < numSamples; ++i)
+                dest[i] = a.getNextValue() * b.getNextValue();
+        }
 
-            distCompGain.process(context);
+        static void applyGains(const juce::dsp::AudioBlock<const SampleType>& source, juce::dsp::AudioBlock<SampleType>& dest, const SampleType* values)
+        {
+            for (size_t channel = 0; channel < dest.getNumChannels(); ++channel)
+                juce::FloatVectorOperations::multiply(dest.getChannelPointer(channel), source.getChannelPointer(channel), values, (int) dest.getNumSamples());
         }
 
-        juce::dsp::Gain<float> distInputGain, distCompGain;
-        NonInvertingOpAmpClipper distortion;
-        juce::dsp::Oversampling<float> oversampler { 2, 2, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, false };
+        juce::SmoothedValue<SampleType> gains[numGainStages];
+        std::vector<SampleType> preGains, postGains;
+        Clippers<SampleType> distortion;
+
+        std::unique_ptr<Oversampling> oversamplers[numOversamplingFilters][maxOversamplingOrder];
+        Oversampling* oversampler = nullptr;
+        size_t oversamplingOrder = 2;
+        OversamplingFilter oversamplingFilter = iirFilter;
+        double sampleRate = 44100.0;
+        size_t maxSubBlockSize = defaultSubBlockSize;
+        size_t subBlockSize = defaultSubBlockSize;
+
+        juce::uint32 oversamplerChannels = 0;
+
+        // Pads the circuit's delay to a whole number of samples
+        juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::Thiran> circuitDelay { 4 };
+        float circuitPadding = 0.f;
+
+        std::shared_ptr<const int> oversamplerTails[numOversamplingFilters][maxOversamplingOrder];
+        size_t tailSamples = 0;
+        std::atomic<double> tailSeconds { 0.0 };
+        size_t silentSamples = 0;
+        bool asleep = false;
     };
 
-    ParameterReferences parameters;
-    juce::AudioProcessorValueTreeState apvts;
+    // Direct access to the DSP for either precision, used by the headless
+    // tools to time it without the rest of processBlock
+    template <typename SampleType>
+    DistortionProcessor<SampleType>& getDistortionProcessor() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleProcessor;
+        else
+            return floatProcessor;
+    }
 
-    enum ProcessorIndices
+    // The most samples the oversampler and circuit process at once, whatever
+    // the host's block size. Smaller sizes keep the oversampled buffers in
+    // cache. Takes effect on the next prepareToPlay.
+    void setSubBlockSize (int samples)
+    {
+        floatProcessor.setSubBlockSize ((size_t) juce::jmax (1, samples));
+        doubleProcessor.setSubBlockSize ((size_t) juce::jmax (1, samples));
+    }
+
+   #if SYN_SOLVER_STATS
+    MetricsPublisher& getMetricsPublisher() noexcept { return metricsPublisher; }
+   #endif
+
+private:
+    enum SnapshotIndices
     {
-        inputGainIndex,
-        distortionProcessorIndex,
-        outputGainIndex
+        inputGainValue,
+        distInputGainValue,
+        distCompGainValue,
+        outputGainValue,
+        circuitModelValue,
+        solverModeValue,
+        oversamplingFactorValue,
+        oversamplingFilterValue,
+        adaptiveQualityValue,
+        cpuBudgetValue,
+        solverPrecisionValue,
+        c1Value,
+        r4Value,
+        c2Value,
+        driveValue,
+        numSnapshotValues
     };
 
-    using Chain = juce::dsp::ProcessorChain<juce::dsp::Gain<float>, DistortionProcessor, juce::dsp::Gain<float>>;
-    Chain chain;
+    using Snapshot = ParameterSnapshot<numSnapshotValues>;
+
+    // Only the DSP for the precision the host processes in is prepared and
+    // kept up to date. A change of precision comes with a prepareToPlay,
+    // which brings the other one up to date.
+    template <typename SampleType>
+    void prepare (double sampleRate, int samplesPerBlock, int numChannels);
+
+    template <typename SampleType>
+    void resetProcessing();
+
+    template <typename SampleType>
+    void process (juce::AudioBuffer<SampleType>& buffer);
+
+    // Applies the parameters flagged in dirty, a mask from Snapshot::read()
+    template <typename SampleType>
+    void update(uint32_t dirty);
+
+    // Sets the solver from the user's choice and the governor's level
+    template <typename SampleType>
+    void applyQuality();
+
+    // Passes the component values in the snapshot to the nodal circuit
+    template <typename SampleType>
+    void applyComponents();
+
+    template <typename SampleType>
+    TableBuilder<SampleType>& getTableBuilder() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleTableBuilder;
+        else
+            return floatTableBuilder;
+    }
+
+    ParameterReferences parameters;
+    juce::AudioProcessorValueTreeState apvts;
+
+    Snapshot snapshot { apvts, { ID::inputGain, ID::distInputGain, ID::distCompGain, ID::outputGain,
+                                 ID::circuitModel, ID::solverMode, ID::oversamplingFactor, ID::oversamplingFilter,
+                                 ID::adaptiveQuality, ID::cpuBudget, ID::solverPrecision, ID::c1, ID::r4, ID::c2, ID::drive } };
+
+    StateSerializer stateSerializer { *this };
+
+    // Odd while setStateInformation() is writing the parameters, so the audio
+    // thread applies a restored state in one update rather than piecemeal
+    std::atomic<juce::uint32> stateRestores { 0 };
+
+    DistortionProcessor<float> floatProcessor;
+    DistortionProcessor<double> doubleProcessor;
+
+    juce::AudioProcessLoadMeasurer loadMeasurer;
+    QualityGovernor governor;
+    TableBuilder<float> floatTableBuilder;
+    TableBuilder<double> doubleTableBuilder;
+
+   #if SYN_SOLVER_STATS
+    template <typename SampleType>
+    void publishMetrics (juce::uint32 numSamples);
 
-    std::atomic<bool> requiresUpdate { true };
+    MetricsFifo metricsFifo;
+    MetricsPublisher metricsPublisher { metricsFifo };
+   #endif
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioPluginAudioProcessor)
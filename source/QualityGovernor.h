@@ -0,0 +1,100 @@
+#pragma once
+
+// Steps the circuit's quality down while the processing load is over budget
+// and back up once it has stayed well under budget for a while. Fed once per
+// block on the audio thread; no locks and no allocation.
+//
+// The levels only touch the solver. A lower oversampling factor would also
+// change the plugin's latency, which hosts can't compensate mid-playback.
+class QualityGovernor
+{
+public:
+	QualityGovernor() {}
+	~QualityGovernor() {}
+
+	enum Level
+	{
+		fullQuality,        // the user's settings
+		reducedIterations,  // Newton capped at reducedIterationCap per sample
+		tableSolver,        // the nodal circuit switches to its lookup table
+		numLevels
+	};
+
+	static constexpr uint32_t reducedIterationCap = 8;
+
+	// Load is a proportion of the block's real-time duration, as reported by
+	// juce::AudioProcessLoadMeasurer. A host with a fixed budget per node
+	// can lower it.
+	void setBudget(float newBudget) { budget = juce::jlimit(0.05f, 1.f, newBudget); }
+	float getBudget() const { return budget; }
+
+	void reset()
+	{
+		level = fullQuality;
+		blocksOver = 0;
+		blocksUnder = 0;
+	}
+
+	// Returns true if the level changed
+	bool update(float load)
+	{
+		if (load > budget && level + 1 < numLevels)
+		{
+			blocksUnder = 0;
+
+			if (++blocksOver >= degradeAfterBlocks)
+				return setLevel((Level) (level + 1));
+		}
+		else if (load < budget * recoverBelow && level > fullQuality)
+		{
+			blocksOver = 0;
+
+			if (++blocksUnder >= recoverAfterBlocks)
+				return setLevel((Level) (level - 1));
+		}
+		else
+		{
+			blocksOver = 0;
+			blocksUnder = 0;
+		}
+
+		return false;
+	}
+
+	Level getLevel() const { return level; }
+
+	static const char* getLevelName(Level levelToName)
+	{
+		switch (levelToName)
+		{
+			case fullQuality:       return "full";
+			case reducedIterations: return "reduced iterations";
+			case tableSolver:       return "table solver";
+			case numLevels:         break;
+		}
+
+		return "";
+	}
+
+private:
+	// Quick to step down so a spike doesn't turn into dropouts, slow to step
+	// back up so the level doesn't oscillate around the budget
+	static constexpr uint32_t degradeAfterBlocks = 2;
+	static constexpr uint32_t recoverAfterBlocks = 256;
+	static constexpr float recoverBelow = 0.5f;
+
+	float budget = 0.75f;
+	Level level = fullQuality;
+	uint32_t blocksOver = 0;
+	uint32_t blocksUnder = 0;
+
+	bool setLevel(Level newLevel)
+	{
+		level = newLevel;
+		blocksOver = 0;
+		blocksUnder = 0;
+		return true;
+	}
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QualityGovernor)
+};
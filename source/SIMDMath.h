@@ -0,0 +1,82 @@
+#pragma once
+
+#if JUCE_USE_SIMD
+
+// Element-wise helpers that juce::dsp::SIMDRegister doesn't provide
+namespace SIMDMath
+{
+	using Vec = juce::dsp::SIMDRegister<float>;
+	using Mask = Vec::vMaskType;
+
+	inline Mask toBits(Vec x)
+	{
+		Mask bits;
+		std::memcpy(&bits, &x, sizeof(Vec));
+		return bits;
+	}
+
+	inline Vec fromBits(Mask bits)
+	{
+		Vec x;
+		std::memcpy(&x, &bits, sizeof(Vec));
+		return x;
+	}
+
+	inline Vec abs(Vec x)
+	{
+		return x & Mask::expand(0x7fffffffu);
+	}
+
+	// Picks a where the mask is set and b elsewhere
+	inline Vec select(Mask mask, Vec a, Vec b)
+	{
+		return (a & mask) + (b & ~mask);
+	}
+
+	inline bool any(Mask mask)
+	{
+		return mask.sum() != 0u;
+	}
+
+	inline Vec divide(Vec a, Vec b)
+	{
+	   #if JUCE_USE_SSE_INTRINSICS
+		return Vec::fromNative(_mm_div_ps(a.value, b.value));
+	   #elif JUCE_USE_ARM_NEON && (defined (__aarch64__) || defined (_M_ARM64))
+		return Vec::fromNative(vdivq_f32(a.value, b.value));
+	   #else
+		for (size_t i = 0; i < Vec::size(); ++i)
+			a.set(i, a.get(i) / b.get(i));
+
+		return a;
+	   #endif
+	}
+
+	// exp(x) = 2^n * e^f with n = round(x / ln2) and |f| <= ln2 / 2. e^f comes
+	// from a degree 6 polynomial and 2^n is written straight into the
+	// exponent bits. Relative error is below 3e-7 over the clamped range.
+	inline Vec exp(Vec x)
+	{
+		const float magic = 12582912.f;
+
+		x = Vec::min(Vec::max(x, Vec::expand(-87.f)), Vec::expand(88.f));
+
+		const Vec rounded = x * 1.44269504f + magic;
+		const Vec r = rounded - magic;
+		const Vec f = x - r * 0.693145752f - r * 1.42860677e-6f;
+
+		Vec poly = Vec::expand(1.f / 720.f);
+		poly = poly * f + 1.f / 120.f;
+		poly = poly * f + 1.f / 24.f;
+		poly = poly * f + 1.f / 6.f;
+		poly = poly * f + 0.5f;
+		poly = poly * f + 1.f;
+		poly = poly * f + 1.f;
+
+		const Mask n = toBits(rounded) - toBits(Vec::expand(magic));
+
+		return fromBits(toBits(poly) + n * Mask::expand(1u << 23));
+	}
+}
+
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <future>
+
+// Immutable data that every plugin instance in the process would otherwise
+// build for itself, e.g. solver lookup tables, shared between them. A
+// resource lives as long as some instance holds it, and is built again the
+// next time it's asked for after that.
+//
+// get() may allocate, build, or wait for another thread's build, so call it
+// from prepare or a background thread, not the audio thread. Copying the
+// returned pointer around afterwards is fine anywhere.
+template <typename Key, typename Resource>
+class SharedResourceCache
+{
+public:
+	// The process-wide cache for this key and resource type
+	static SharedResourceCache& getInstance()
+	{
+		static SharedResourceCache instance;
+		return instance;
+	}
+
+	// Returns the resource for key, calling build() to make it if no
+	// instance holds one. build returns a Resource. The lock is only held to
+	// look the key up, so builds for different keys run in parallel, and a
+	// thread asking for a key that is being built waits for that build
+	// rather than starting another.
+	template <typename Build>
+	std::shared_ptr<const Resource> get(const Key& key, Build&& build)
+	{
+		std::promise<std::shared_ptr<const Resource>> promise;
+		std::shared_future<std::shared_ptr<const Resource>> building;
+
+		{
+			const juce::ScopedLock lock (mutex);
+
+			entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) { return ! entry.building.valid() && entry.resource.expired(); }),
+						  entries.end());
+
+			for (const auto& entry : entries)
+			{
+				if (entry.key == key)
+				{
+					if (auto resource = entry.resource.lock())
+						return resource;
+
+					building = entry.building;
+				}
+			}
+
+			if (! building.valid())
+				entries.push_back({ key, {}, promise.get_future().share() });
+		}
+
+		if (building.valid())
+			return building.get();
+
+		auto resource = std::make_shared<const Resource>(build());
+
+		{
+			const juce::ScopedLock lock (mutex);
+
+			for (auto& entry : entries)
+			{
+				if (entry.key == key && entry.building.valid())
+				{
+					entry.resource = resource;
+					entry.building = {};
+					break;
+				}
+			}
+		}
+
+		promise.set_value(resource);
+		return resource;
+	}
+
+	// Resources currently held by at least one instance
+	size_t size() const
+	{
+		const juce::ScopedLock lock (mutex);
+		return (size_t) std::count_if(entries.begin(), entries.end(), [](const Entry& entry) { return ! entry.resource.expired(); });
+	}
+
+private:
+	SharedResourceCache() {}
+	~SharedResourceCache() {}
+
+	// An entry whose resource is still being built holds the build's future
+	struct Entry
+	{
+		Key key;
+		std::weak_ptr<const Resource> resource;
+		std::shared_future<std::shared_ptr<const Resource>> building;
+	};
+
+	juce::CriticalSection mutex;
+	std::vector<Entry> entries;
+
+	JUCE_DECLARE_NON_COPYABLE (SharedResourceCache)
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+// Newton solver counters. They are only collected when SYN_SOLVER_STATS is
+// defined to 1, otherwise the instrumentation compiles away.
+#ifndef SYN_SOLVER_STATS
+ #define SYN_SOLVER_STATS 0
+#endif
+
+struct SolverStats
+{
+	uint64_t solves = 0;
+	uint64_t iterations = 0;
+	uint64_t backtracks = 0;
+	uint64_t capHits = 0;
+	uint32_t maxIterations = 0;
+
+	void add(uint32_t solveIterations, uint32_t solveBacktracks, bool hitCap)
+	{
+		++solves;
+		iterations += solveIterations;
+		backtracks += solveBacktracks;
+		capHits += hitCap ? 1 : 0;
+		maxIterations = juce::jmax(maxIterations, solveIterations);
+	}
+
+	double getAverageIterations() const
+	{
+		return solves > 0 ? (double) iterations / (double) solves : 0.0;
+	}
+
+	void clear()
+	{
+		*this = SolverStats();
+	}
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+// Saves and restores every parameter in a small binary block instead of the
+// APVTS's XML, which takes milliseconds per instance to write and parse.
+//
+// Layout, little endian:
+//
+//     uint32  magic, "SYNS"
+//     uint16  version
+//     uint16  number of entries
+//     entries, each a uint32 hash of the parameter ID and its float value
+//
+// Values are plain (dB, choice index, 0 or 1) rather than normalised, so a
+// range change doesn't move saved settings. Entries are matched by ID, so
+// parameters can be added, removed and reordered freely. A parameter that
+// isn't in the data goes back to its default, and an unknown entry is
+// skipped. Renaming a parameter needs an entry in renames, below, and a
+// version bump.
+class StateSerializer
+{
+public:
+	explicit StateSerializer(juce::AudioProcessor& processor)
+	{
+		for (auto* parameter : processor.getParameters())
+			if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+				parameters.push_back({ hash(ranged->getParameterID().toRawUTF8()), ranged });
+
+		std::sort(parameters.begin(), parameters.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+
+		for (size_t i = 1; i < parameters.size(); ++i)
+			jassert (parameters[i - 1].id != parameters[i].id);   // Two IDs hash the same, rename one
+	}
+
+	~StateSerializer() {}
+
+	static constexpr uint32_t magic = 0x534e5953;   // "SYNS" when written little endian
+	static constexpr uint16_t currentVersion = 1;
+	static constexpr size_t headerSize = 8;
+	static constexpr size_t entrySize = 8;
+
+	void write(juce::MemoryBlock& destData) const
+	{
+		destData.setSize(headerSize + parameters.size() * entrySize);
+		auto* data = static_cast<char*>(destData.getData());
+
+		writeInt(data, magic);
+		writeInt(data + 4, (uint32_t) currentVersion | ((uint32_t) parameters.size() << 16));
+		data += headerSize;
+
+		for (const auto& entry : parameters)
+		{
+			const auto value = entry.parameter->convertFrom0to1(entry.parameter->getValue());
+
+			writeInt(data, entry.id);
+			writeFloat(data + 4, value);
+			data += entrySize;
+		}
+	}
+
+	// Returns false, leaving the parameters untouched, if the data isn't in
+	// this format or is from a newer version
+	bool read(const void* source, int sizeInBytes)
+	{
+		if (source == nullptr || sizeInBytes < (int) headerSize)
+			return false;
+
+		const auto* data = static_cast<const char*>(source);
+		const auto versionAndCount = readInt(data + 4);
+		const auto version = (uint16_t) (versionAndCount & 0xffff);
+		const auto count = (size_t) (versionAndCount >> 16);
+
+		if (readInt(data) != magic || version == 0 || version > currentVersion
+			|| (size_t) sizeInBytes < headerSize + count * entrySize)
+			return false;
+
+		data += headerSize;
+
+		for (auto& entry : parameters)
+			entry.restored = false;
+
+		for (size_t i = 0; i < count; ++i, data += entrySize)
+		{
+			auto* entry = find(migrate(readInt(data), version));
+			const auto value = readFloat(data + 4);
+
+			if (entry == nullptr || ! std::isfinite(value))
+				continue;
+
+			auto* parameter = entry->parameter;
+
+			parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+			entry->restored = true;
+		}
+
+		for (auto& entry : parameters)
+			if (! entry.restored)
+				entry.parameter->setValueNotifyingHost(entry.parameter->getDefaultValue());
+
+		return true;
+	}
+
+	// FNV-1a
+	static constexpr uint32_t hash(const char* id)
+	{
+		uint32_t result = 2166136261u;
+
+		for (; *id != 0; ++id)
+			result = (result ^ (uint8_t) *id) * 16777619u;
+
+		return result;
+	}
+
+private:
+	struct Entry
+	{
+		uint32_t id;
+		juce::RangedAudioParameter* parameter;
+		bool restored = false;
+	};
+
+	// A parameter renamed in version newVersion, e.g. if distInputGain
+	// became drive in version 2: { 2, "distInputGain", ID::drive }
+	struct Rename
+	{
+		uint16_t newVersion;
+		const char* oldId;
+		const char* newId;
+	};
+
+	static constexpr std::array<Rename, 0> renames {};
+
+	std::vector<Entry> parameters;
+
+	// Follows every rename made after the data was written
+	static uint32_t migrate(uint32_t id, uint16_t version)
+	{
+		for (const auto& rename : renames)
+			if (rename.newVersion > version && hash(rename.oldId) == id)
+				id = hash(rename.newId);
+
+		return id;
+	}
+
+	Entry* find(uint32_t id)
+	{
+		auto it = std::lower_bound(parameters.begin(), parameters.end(), id, [](const Entry& entry, uint32_t value) { return entry.id < value; });
+		return it != parameters.end() && it->id == id ? &*it : nullptr;
+	}
+
+	static void writeInt(char* dest, uint32_t value)
+	{
+		value = juce::ByteOrder::swapIfBigEndian(value);
+		std::memcpy(dest, &value, sizeof(value));
+	}
+
+	static uint32_t readInt(const char* source)
+	{
+		return juce::ByteOrder::littleEndianInt(source);
+	}
+
+	static void writeFloat(char* dest, float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		writeInt(dest, bits);
+	}
+
+	static float readFloat(const char* source)
+	{
+		const auto bits = readInt(source);
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StateSerializer)
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "NonInvertingOpAmpClipper.h"
+
+// Fetches the nodal circuit's lookup tables on a background thread, for when
+// the table solver or the quality governor is switched on after prepare
+// skipped the tables. The circuit iterates until they arrive, typically a
+// few blocks later.
+//
+// request() and deliver() run on the audio thread and neither lock nor
+// allocate. The tables are fetched into a second instance of the circuit
+// and swapped into the running one, which leaves the tables it held, if
+// any, to be released here rather than on the audio thread. SampleType is
+// that of the circuit it fills.
+template <typename SampleType>
+class TableBuilder : private juce::Thread
+{
+public:
+	using Circuit = NonInvertingOpAmpClipper<SampleType>;
+
+	TableBuilder() : juce::Thread ("SYN table builder") {}
+
+	~TableBuilder()
+	{
+		stopThread(-1);
+	}
+
+	// The rates, precision and convergence criterion the tables are for.
+	// Waits for a build in progress, so call it from prepare while the
+	// audio thread is stopped.
+	void prepare(const std::vector<float>& rates, const Circuit& circuit)
+	{
+		stopThread(-1);
+
+		sampleRates = rates;
+		builder.setDiodePrecision(circuit.getDiodePrecision());
+		builder.setConvergenceCriterion(circuit.getConvergenceCriterion());
+		builder.setKeepTableReady(true);
+		builder.prepareSampleRates({});
+		state.store(idle, std::memory_order_relaxed);
+
+		startThread();
+	}
+
+	// Starts fetching the tables. Once per prepare; later calls do nothing.
+	void request()
+	{
+		auto expected = idle;
+
+		if (state.compare_exchange_strong(expected, building, std::memory_order_relaxed))
+			notify();
+	}
+
+	// Hands the tables to circuit once they are ready
+	void deliver(Circuit& circuit)
+	{
+		if (state.load(std::memory_order_acquire) != built)
+			return;
+
+		circuit.swapPreparedTables(builder);
+		state.store(delivered, std::memory_order_relaxed);
+	}
+
+private:
+	enum State
+	{
+		idle,
+		building,
+		built,
+		delivered
+	};
+
+	void run() override
+	{
+		while (! threadShouldExit())
+		{
+			wait(-1);
+
+			if (state.load(std::memory_order_relaxed) == building && ! threadShouldExit())
+			{
+				builder.prepareSampleRates(sampleRates);
+				state.store(built, std::memory_order_release);
+			}
+		}
+	}
+
+	Circuit builder;
+	std::vector<float> sampleRates;
+	std::atomic<State> state { idle };
+
+	//==============================================================================
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TableBuilder)
+};
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "DiodeModel.h"
+
+// Wave digital filter building blocks. Every element is a one-port with a
+// port resistance R and incident and reflected waves a and b, so that
+// v = (a + b) / 2 and i = (a - b) / 2R. Adaptors join two children into one
+// adapted port, and the tree is closed by a root element which may be
+// nonlinear. Trees are assembled from templates, so a circuit compiles down
+// to straight-line code with no virtual calls.
+//
+// After changing a child's resistance, call update() on every adaptor above
+// it, from the leaves up, and then on the root.
+//
+// The leaves take the sample type T, float or double, and the adaptors and
+// roots take theirs from the ports they join.
+namespace WDF
+{
+	// Wright omega function, the solution w of w + log(w) = x. A cubic fit
+	// refined by a fixed number of Newton steps. Absolute error is 0.045 after
+	// one step, 1.2e-3 after two and 3.8e-6 after three. Each step squares the
+	// error, so double precision needs five.
+	template <int refinements = 3, typename T = float>
+	inline T omega(T x)
+	{
+		const T x1 = (T) -3.341459552768620;
+		const T x2 = (T) 8;
+
+		T w;
+
+		if (x < x1)
+			w = std::exp(x);
+		else if (x < x2)
+			w = (T) 0.6313183464296682 + x * ((T) 0.3631952663804445 + x * ((T) 0.04775931364975583 + x * (T) -0.001314293149877800));
+		else
+			w = x - std::log(x);
+
+		for (int i = 0; i < refinements; ++i)
+			w -= (w - std::exp(x - w)) / (w + (T) 1);
+
+		return w;
+	}
+
+	template <typename T>
+	struct Port
+	{
+		using SampleType = T;
+
+		T R = (T) 1;
+		T G = (T) 1;
+		T a = (T) 0;
+		T b = (T) 0;
+
+		void setPortResistance(T newResistance)
+		{
+			R = newResistance;
+			G = (T) 1 / newResistance;
+		}
+
+		T voltage() const { return (T) 0.5 * (a + b); }
+		T current() const { return (T) 0.5 * (a - b) * G; }
+	};
+
+	//==============================================================================
+	template <typename T>
+	class Resistor : public Port<T>
+	{
+	public:
+		explicit Resistor(T resistance) { this->setPortResistance(resistance); }
+
+		void incident(T x) { this->a = x; }
+		T reflected() { this->b = (T) 0; return this->b; }
+	};
+
+	// Trapezoidal rule capacitor, R = Ts / 2C
+	template <typename T>
+	class Capacitor : public Port<T>
+	{
+	public:
+		explicit Capacitor(T capacitance) : C(capacitance) {}
+
+		void prepare(T Ts) { this->setPortResistance(Ts / ((T) 2 * C)); }
+		void reset() { z = (T) 0; }
+
+		T getCapacitance() const { return C; }
+		T getState() const { return z; }
+
+		void incident(T x) { this->a = x; z = this->a; }
+		T reflected() { this->b = z; return this->b; }
+
+	private:
+		T C;
+		T z = (T) 0;
+	};
+
+	template <typename T>
+	class ResistiveVoltageSource : public Port<T>
+	{
+	public:
+		explicit ResistiveVoltageSource(T resistance) { this->setPortResistance(resistance); }
+
+		void setVoltage(T newVoltage) { Vs = newVoltage; }
+
+		void incident(T x) { this->a = x; }
+		T reflected() { this->b = Vs; return this->b; }
+
+	private:
+		T Vs = (T) 0;
+	};
+
+	// Current source with a resistance in parallel, seen from the port as its
+	// Thevenin equivalent
+	template <typename T>
+	class ResistiveCurrentSource : public Port<T>
+	{
+	public:
+		explicit ResistiveCurrentSource(T resistance) { this->setPortResistance(resistance); }
+
+		void setCurrent(T newCurrent) { Is = newCurrent; }
+
+		void incident(T x) { this->a = x; }
+		T reflected() { this->b = Is * this->R; return this->b; }
+
+	private:
+		T Is = (T) 0;
+	};
+
+	//==============================================================================
+	template <typename Port1, typename Port2>
+	class Series : public Port<typename Port1::SampleType>
+	{
+	public:
+		using T = typename Port1::SampleType;
+
+		Series(Port1& first, Port2& second)
+			: port1(first), port2(second)
+		{
+			update();
+		}
+
+		void update()
+		{
+			this->setPortResistance(port1.R + port2.R);
+			port1Reflection = port1.R / this->R;
+		}
+
+		void incident(T x)
+		{
+			this->a = x;
+
+			const T b1 = port1.b - port1Reflection * (x + port1.b + port2.b);
+			port1.incident(b1);
+			port2.incident(-(x + b1));
+		}
+
+		T reflected()
+		{
+			this->b = -(port1.reflected() + port2.reflected());
+			return this->b;
+		}
+
+	private:
+		Port1& port1;
+		Port2& port2;
+		T port1Reflection = (T) 0.5;
+	};
+
+	template <typename Port1, typename Port2>
+	class Parallel : public Port<typename Port1::SampleType>
+	{
+	public:
+		using T = typename Port1::SampleType;
+
+		Parallel(Port1& first, Port2& second)
+			: port1(first), port2(second)
+		{
+			update();
+		}
+
+		void update()
+		{
+			this->setPortResistance((T) 1 / (port1.G + port2.G));
+			port1Reflection = port1.G * this->R;
+		}
+
+		void incident(T x)
+		{
+			this->a = x;
+
+			const T b2 = x + this->b - port2.b;
+			port1.incident(b2 + bDiff);
+			port2.incident(b2);
+		}
+
+		T reflected()
+		{
+			port1.reflected();
+			port2.reflected();
+
+			bDiff = port2.b - port1.b;
+			this->b = port2.b - port1Reflection * bDiff;
+			return this->b;
+		}
+
+	private:
+		Port1& port1;
+		Port2& port2;
+		T port1Reflection = (T) 0.5;
+		T bDiff = (T) 0;
+	};
+
+	//==============================================================================
+	template <typename Next>
+	class IdealVoltageSource
+	{
+	public:
+		using T = typename Next::SampleType;
+
+		explicit IdealVoltageSource(Next& tree) : next(tree) {}
+
+		void setVoltage(T newVoltage) { Vs = newVoltage; }
+
+		void process()
+		{
+			a = next.reflected();
+			b = (T) 2 * Vs - a;
+			next.incident(b);
+		}
+
+	private:
+		Next& next;
+		T Vs = (T) 0;
+		T a = (T) 0;
+		T b = (T) 0;
+	};
+
+	// Anti-parallel diode pair as the root. Only the forward biased diode is
+	// kept, which makes the root's equation solvable with the Wright omega
+	// function (Werner et al., "An Improved and Generalized Diode Clipper Model
+	// for Wave Digital Filters", 2015). The dropped reverse current is below
+	// Is, negligible next to any resistance in the tree.
+	template <typename Next>
+	class DiodePairRoot
+	{
+	public:
+		using T = typename Next::SampleType;
+
+		DiodePairRoot(Next& tree, const DiodePair& pair)
+			: next(tree), diodes(pair)
+		{
+			update();
+		}
+
+		void update()
+		{
+			nVt = (T) 1 / (T) diodes.invNVt;
+			RIs = next.R * (T) diodes.Is;
+			RIsOverNVt = RIs * (T) diodes.invNVt;
+			logRIsOverNVt = std::log(RIsOverNVt);
+		}
+
+		void process()
+		{
+			a = next.reflected();
+
+			const T lambda = a < (T) 0 ? (T) -1 : (T) 1;
+			b = a + (T) 2 * lambda * (RIs - nVt * omega<omegaRefinements>(logRIsOverNVt + lambda * a * (T) diodes.invNVt + RIsOverNVt));
+
+			next.incident(b);
+		}
+
+		T voltage() const { return (T) 0.5 * (a + b); }
+
+	private:
+		// Enough for the sample type's precision, see omega()
+		static constexpr int omegaRefinements = std::is_same_v<T, double> ? 5 : 3;
+
+		Next& next;
+		DiodePair diodes;
+
+		T nVt = (T) 0;
+		T RIs = (T) 0;
+		T RIsOverNVt = (T) 0;
+		T logRIsOverNVt = (T) 0;
+
+		T a = (T) 0;
+		T b = (T) 0;
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ClipperBase.h"
+#include "WDF.h"
+
+// The non-inverting op-amp clipper as a wave digital filter. The inverting
+// input follows Vin, so the current through R4 and C1 to ground is set by
+// Vin alone. That current drives the feedback network of R3, C2 and the
+// diodes, whose voltage is added to Vin at the output. The diode root has a
+// closed form, so every sample costs the same with no iteration.
+template <typename SampleType>
+class WDFOpAmpClipper : public ClipperBase<WDFOpAmpClipper<SampleType>, SampleType>
+{
+public:
+	WDFOpAmpClipper() {}
+	~WDFOpAmpClipper() {}
+
+	// The capacitors' stored waves are voltages
+	bool isQuiescent(float tolerance) const
+	{
+		for (const auto& circuit : circuits)
+			if (std::abs(circuit.C1.getState()) > (SampleType) tolerance || std::abs(circuit.C2.getState()) > (SampleType) tolerance)
+				return false;
+
+		return true;
+	}
+
+	void clearState()
+	{
+		for (auto& circuit : circuits)
+		{
+			circuit.C1.reset();
+			circuit.C2.reset();
+		}
+	}
+
+	float getTimeConstant() const
+	{
+		const auto& circuit = circuits[0];
+		return (float) juce::jmax(circuit.R4.R * circuit.C1.getCapacitance(), circuit.R3.R * circuit.C2.getCapacitance());
+	}
+
+private:
+	friend class ClipperBase<WDFOpAmpClipper<SampleType>, SampleType>;
+	using Base = ClipperBase<WDFOpAmpClipper<SampleType>, SampleType>;
+
+	struct Circuit
+	{
+		Circuit() {}
+
+		WDF::Resistor<SampleType> R4 { (SampleType) 4700 };
+		WDF::Capacitor<SampleType> C1 { (SampleType) 47e-9 };
+		WDF::Series<WDF::Resistor<SampleType>, WDF::Capacitor<SampleType>> inputBranch { R4, C1 };
+		WDF::IdealVoltageSource<decltype(inputBranch)> input { inputBranch };
+
+		WDF::ResistiveCurrentSource<SampleType> R3 { (SampleType) 551000 };
+		WDF::Capacitor<SampleType> C2 { (SampleType) 51e-12 };
+		WDF::Parallel<WDF::ResistiveCurrentSource<SampleType>, WDF::Capacitor<SampleType>> feedback { R3, C2 };
+		WDF::DiodePairRoot<decltype(feedback)> diodes { feedback, Base::clippingDiodePair };
+
+		JUCE_DECLARE_NON_COPYABLE (Circuit)
+	};
+
+	std::array<Circuit, Base::maxChannels> circuits;
+
+	SampleType processSingleSample(SampleType Vin, size_t channel)
+	{
+		auto& circuit = circuits[channel];
+
+		circuit.input.setVoltage(Vin);
+		circuit.input.process();
+
+		circuit.R3.setCurrent(-circuit.R4.current());
+		circuit.diodes.process();
+
+		return Vin + circuit.diodes.voltage();
+	}
+
+	void updateCoefficients()
+	{
+		for (auto& circuit : circuits)
+		{
+			circuit.C1.prepare(this->Ts);
+			circuit.C2.prepare(this->Ts);
+
+			circuit.inputBranch.update();
+			circuit.feedback.update();
+			circuit.diodes.update();
+		}
+	}
+
+	//==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WDFOpAmpClipper)
+};
@@ -0,0 +1,156 @@
+#include "AliasingAnalysis.h"
+
+namespace Render
+{
+    namespace
+    {
+        // The analysis window, after a settling time for the circuit and
+        // the oversampling filters
+        constexpr int analysisSize = 1 << 15;
+        constexpr double settleSeconds = 0.25;
+    }
+
+    //==============================================================================
+    double AliasingReport::getWorstAliasingDb (double driveDb, int order) const
+    {
+        auto worst = SpectrumMetrics::floorDb;
+
+        for (auto& measurement : measurements)
+            if (measurement.driveDb == driveDb && measurement.order == order)
+                worst = juce::jmax (worst, measurement.metrics.aliasingDb);
+
+        return worst;
+    }
+
+    int AliasingReport::getMinimumOrder (double driveDb) const
+    {
+        for (int order = 0; order <= maxOrder; ++order)
+            if (getWorstAliasingDb (driveDb, order) <= settings.targetDb)
+                return order;
+
+        return -1;
+    }
+
+    juce::String AliasingReport::toString() const
+    {
+        juce::String text;
+        text << "Worst aliasing in dB over " << (int) settings.frequencies.size() << " frequencies at "
+             << settings.sampleRate << " Hz, target " << settings.targetDb << " dB" << juce::newLine
+             << juce::String ("drive dB").paddedRight (' ', 10);
+
+        for (int order = 0; order <= maxOrder; ++order)
+            text << (juce::String (1 << order) + "x").paddedLeft (' ', 9);
+
+        text << "   lowest" << juce::newLine;
+
+        for (auto driveDb : settings.drivesDb)
+        {
+            text << juce::String (driveDb, 1).paddedRight (' ', 10);
+
+            for (int order = 0; order <= maxOrder; ++order)
+                text << juce::String (getWorstAliasingDb (driveDb, order), 1).paddedLeft (' ', 9);
+
+            const auto minimum = getMinimumOrder (driveDb);
+            text << (minimum >= 0 ? (juce::String (1 << minimum) + "x") : juce::String ("none")).paddedLeft (' ', 9) << juce::newLine;
+        }
+
+        text << juce::newLine << "THD in dB at the lowest order" << juce::newLine
+             << juce::String ("drive dB").paddedRight (' ', 10);
+
+        for (auto frequency : settings.frequencies)
+            text << (juce::String (frequency, 0) + " Hz").paddedLeft (' ', 10);
+
+        text << juce::newLine;
+
+        for (auto driveDb : settings.drivesDb)
+        {
+            const auto order = juce::jmax (0, getMinimumOrder (driveDb));
+            text << juce::String (driveDb, 1).paddedRight (' ', 10);
+
+            for (auto& measurement : measurements)
+                if (measurement.driveDb == driveDb && measurement.order == order)
+                    text << juce::String (measurement.metrics.thdDb, 1).paddedLeft (' ', 10);
+
+            text << juce::newLine;
+        }
+
+        return text;
+    }
+
+    juce::String AliasingReport::toHeader() const
+    {
+        juce::String text;
+        text << "#pragma once" << juce::newLine << juce::newLine
+             << "// Generated by SYNRender --aliasing at " << settings.sampleRate << " Hz. The lowest" << juce::newLine
+             << "// oversampling order keeping aliasing under " << settings.targetDb << " dB at each drive, or the" << juce::newLine
+             << "// highest order where none does." << juce::newLine
+             << "struct OversamplingForDrive" << juce::newLine
+             << "{" << juce::newLine
+             << "\tfloat driveDb;" << juce::newLine
+             << "\tsize_t order;" << juce::newLine
+             << "};" << juce::newLine << juce::newLine
+             << "constexpr OversamplingForDrive oversamplingForDrive[] {" << juce::newLine;
+
+        for (auto driveDb : settings.drivesDb)
+        {
+            const auto order = getMinimumOrder (driveDb);
+            text << "\t{ " << juce::String (driveDb, 1) << "f, " << (order >= 0 ? order : maxOrder) << " }," << juce::newLine;
+        }
+
+        text << "};" << juce::newLine;
+        return text;
+    }
+
+    //==============================================================================
+    bool analyseAliasing (const AliasingSettings& settings, const juce::Array<ParameterValue>& parameters, AliasingReport& report)
+    {
+        report = {};
+        report.settings = settings;
+        report.maxOrder = (int) AudioPluginAudioProcessor::DistortionProcessor<float>::maxOversamplingOrder;
+
+        const auto numSamples = analysisSize + (int) (settleSeconds * settings.sampleRate);
+        juce::AudioBuffer<float> buffer (1, numSamples);
+
+        Settings engineSettings;
+        engineSettings.sampleRate = settings.sampleRate;
+        engineSettings.blockSize = settings.blockSize;
+        engineSettings.numChannels = 1;
+
+        for (auto driveDb : settings.drivesDb)
+        {
+            for (int order = 0; order <= report.maxOrder; ++order)
+            {
+                auto caseParameters = parameters;
+                caseParameters.add ({ ID::distInputGain, (float) driveDb });
+                caseParameters.add ({ ID::oversamplingFactor, (float) order });
+                caseParameters.add ({ ID::adaptiveQuality, 0.0f });
+
+                for (auto frequency : settings.frequencies)
+                {
+                    Engine engine (engineSettings);
+                    juce::String unknownId;
+
+                    if (! engine.setParameters (caseParameters, unknownId))
+                        return false;
+
+                    engine.prepare();
+
+                    for (int i = 0; i < numSamples; ++i)
+                        buffer.setSample (0, i, (float) (0.5 * std::sin (juce::MathConstants<double>::twoPi * frequency * (double) i / settings.sampleRate)));
+
+                    engine.process (buffer);
+
+                    AliasingMeasurement measurement;
+                    measurement.driveDb = driveDb;
+                    measurement.frequency = frequency;
+                    measurement.order = order;
+                    measurement.metrics = analyseSine (buffer.getReadPointer (0), numSamples, settings.sampleRate, frequency);
+
+                    report.measurements.push_back (measurement);
+                }
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GoldenCompare.h"
+
+// Sweeps drive, input frequency and oversampling factor through the
+// processor and measures the harmonics and aliasing of each sine, to find
+// the lowest oversampling factor that keeps aliasing under a target at each
+// drive.
+namespace Render
+{
+    struct AliasingSettings
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+
+        // Drive is distInputGain. The frequencies don't divide common sample
+        // rates, so aliases land between the harmonics.
+        std::vector<double> drivesDb { 0.0, 10.0, 20.0, 30.0, 40.0, 50.0, 60.0 };
+        std::vector<double> frequencies { 101.0, 997.0, 4999.0, 9973.0 };
+
+        // Aliasing relative to the fundamental. The float noise floor over
+        // the analysis window is about -90 dB.
+        double targetDb = -80.0;
+    };
+
+    struct AliasingMeasurement
+    {
+        double driveDb = 0.0;
+        double frequency = 0.0;
+        int order = 0;
+        SpectrumMetrics metrics;
+    };
+
+    struct AliasingReport
+    {
+        AliasingSettings settings;
+        int maxOrder = 0;
+        std::vector<AliasingMeasurement> measurements;
+
+        // Worst aliasing over all frequencies at one drive and order
+        double getWorstAliasingDb (double driveDb, int order) const;
+
+        // The lowest order meeting the target at a drive, or -1 if none does
+        int getMinimumOrder (double driveDb) const;
+
+        juce::String toString() const;
+
+        // A header declaring the minimum order for each drive, for the
+        // plugin to look up
+        juce::String toHeader() const;
+    };
+
+    // Returns false if a parameter ID is unknown. parameters are applied
+    // before the drive and oversampling factor being swept.
+    bool analyseAliasing (const AliasingSettings& settings, const juce::Array<ParameterValue>& parameters, AliasingReport& report);
+}
@@ -0,0 +1,163 @@
+#include "BatchRender.h"
+
+#include <numeric>
+
+namespace Render
+{
+    //==============================================================================
+    int BatchReport::getNumFailed() const
+    {
+        return (int) std::count_if (results.begin(), results.end(), [] (const BatchResult& result) { return ! result.rendered; });
+    }
+
+    double BatchReport::getAudioSeconds() const
+    {
+        double audioSeconds = 0.0;
+
+        for (auto& result : results)
+            if (result.rendered && result.sampleRate > 0.0)
+                audioSeconds += (double) result.numSamples / result.sampleRate;
+
+        return audioSeconds;
+    }
+
+    double BatchReport::getRealTimeFactor() const
+    {
+        return seconds > 0.0 ? getAudioSeconds() / seconds : 0.0;
+    }
+
+    juce::String BatchReport::toString() const
+    {
+        juce::String text;
+
+        text << (int) results.size() - getNumFailed() << " of " << (int) results.size() << " files, "
+             << juce::String (getAudioSeconds(), 1) << " s of audio on " << numThreads << " threads" << juce::newLine
+             << "total        " << juce::String (seconds, 3) << " s, "
+             << juce::String (getRealTimeFactor(), 1) << "x real time" << juce::newLine;
+
+        return text;
+    }
+
+    //==============================================================================
+    juce::Array<BatchJob> findBatchJobs (const juce::File& inputDirectory, const juce::File& outputDirectory)
+    {
+        juce::Array<BatchJob> jobs;
+
+        for (auto& file : inputDirectory.findChildFiles (juce::File::findFiles, false, "*.wav"))
+            jobs.add ({ file, outputDirectory.getChildFile (file.getFileName()) });
+
+        std::sort (jobs.begin(), jobs.end(), [] (const BatchJob& a, const BatchJob& b) { return a.input.getFileName() < b.input.getFileName(); });
+        return jobs;
+    }
+
+    BatchResult renderFile (const BatchJob& job,
+                            const Settings& settings,
+                            const juce::Array<ParameterValue>& parameters,
+                            int chunkSamples)
+    {
+        BatchResult result;
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> reader (format.createReaderFor (job.input.createInputStream().release(), true));
+
+        if (reader == nullptr || reader->numChannels == 0)
+        {
+            result.error = "could not read " + job.input.getFullPathName();
+            return result;
+        }
+
+        Settings fileSettings = settings;
+        fileSettings.sampleRate = reader->sampleRate;
+        fileSettings.numChannels = (int) reader->numChannels;
+        fileSettings.timeStages = false;
+
+        Engine engine (fileSettings);
+        juce::String unknownId;
+
+        if (! engine.setParameters (parameters, unknownId))
+        {
+            result.error = "unknown parameter " + unknownId;
+            return result;
+        }
+
+        // The governor follows wall-clock load, which would make the output
+        // depend on what else is running
+        engine.setParameter (ID::adaptiveQuality, 0.0f);
+
+        engine.prepare();
+
+        auto writer = createWavWriter (job.output, fileSettings.sampleRate, fileSettings.numChannels);
+
+        if (writer == nullptr)
+        {
+            result.error = "could not write " + job.output.getFullPathName();
+            return result;
+        }
+
+        // Engine::process splits each call into blocks from its start, so
+        // whole blocks per chunk keep the block boundaries of a single call
+        const auto blockSize = juce::jmax (1, settings.blockSize);
+        const auto chunk = blockSize * juce::jmax (1, chunkSamples / blockSize);
+        juce::AudioBuffer<float> buffer (fileSettings.numChannels, chunk);
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples; position += chunk)
+        {
+            const auto numSamples = (int) juce::jmin ((juce::int64) chunk, reader->lengthInSamples - position);
+
+            buffer.setSize (fileSettings.numChannels, numSamples, false, false, true);
+            reader->read (&buffer, 0, numSamples, position, true, true);
+
+            engine.process (buffer);
+
+            if (! writer->writeFromAudioSampleBuffer (buffer, 0, numSamples))
+            {
+                result.error = "could not write " + job.output.getFullPathName();
+                return result;
+            }
+        }
+
+        result.rendered = true;
+        result.numSamples = reader->lengthInSamples;
+        result.sampleRate = fileSettings.sampleRate;
+        result.seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        return result;
+    }
+
+    BatchReport renderBatch (const juce::Array<BatchJob>& jobs,
+                             const Settings& settings,
+                             const juce::Array<ParameterValue>& parameters,
+                             int numThreads)
+    {
+        BatchReport report;
+        report.numThreads = juce::jmax (1, juce::jmin (numThreads, jobs.size()));
+        report.results.resize ((size_t) jobs.size());
+
+        // Every job is a whole file with nothing to split or share, so one
+        // queue that idle workers take from keeps them all busy. Queueing the
+        // largest files first stops one long file from running on alone at
+        // the end.
+        std::vector<int> order ((size_t) jobs.size());
+        std::iota (order.begin(), order.end(), 0);
+        std::stable_sort (order.begin(), order.end(), [&jobs] (int a, int b) { return jobs.getReference (a).input.getSize() > jobs.getReference (b).input.getSize(); });
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        {
+            juce::ThreadPool pool (report.numThreads);
+
+            for (auto index : order)
+                pool.addJob ([&jobs, &settings, &parameters, &report, index]
+                             {
+                                 report.results[(size_t) index] = renderFile (jobs.getReference (index), settings, parameters);
+                             });
+
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep (10);
+        }
+
+        report.seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        return report;
+    }
+}
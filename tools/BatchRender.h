@@ -0,0 +1,55 @@
+#pragma once
+
+#include "RenderEngine.h"
+
+// Renders many WAV files through independent engines across a thread pool.
+// Each file is streamed through its own processor in chunks that are a
+// multiple of the block size, so the output is bit-identical to rendering
+// the file on its own with the same settings, whatever the thread count.
+namespace Render
+{
+    struct BatchJob
+    {
+        juce::File input;
+        juce::File output;
+    };
+
+    struct BatchResult
+    {
+        bool rendered = false;
+        juce::String error;
+        juce::int64 numSamples = 0;
+        double sampleRate = 0.0;
+        double seconds = 0.0;
+    };
+
+    struct BatchReport
+    {
+        int numThreads = 0;
+        double seconds = 0.0;
+        std::vector<BatchResult> results;
+
+        int getNumFailed() const;
+        double getAudioSeconds() const;
+        double getRealTimeFactor() const;
+        juce::String toString() const;
+    };
+
+    // A job for every .wav file in inputDirectory, written to outputDirectory
+    // under the same name
+    juce::Array<BatchJob> findBatchJobs (const juce::File& inputDirectory, const juce::File& outputDirectory);
+
+    // Renders every job, numThreads at a time. settings supplies the block
+    // size; the sample rate and channel count come from each file. The
+    // results are in the same order as the jobs.
+    BatchReport renderBatch (const juce::Array<BatchJob>& jobs,
+                             const Settings& settings,
+                             const juce::Array<ParameterValue>& parameters,
+                             int numThreads);
+
+    // Renders one job, reading and writing chunkSamples at a time
+    BatchResult renderFile (const BatchJob& job,
+                            const Settings& settings,
+                            const juce::Array<ParameterValue>& parameters,
+                            int chunkSamples = 1 << 16);
+}
@@ -0,0 +1,265 @@
+#include "GoldenCompare.h"
+
+namespace Render
+{
+    namespace
+    {
+        constexpr double sineFrequency = 997.0;
+
+        // Long enough for the sine analysis at 44.1 kHz, and short enough to
+        // keep the golden files small at 192 kHz
+        constexpr double sineSeconds = 1.0;
+        constexpr double stereoSeconds = 0.25;
+        constexpr double variantSeconds = 0.1;
+
+        // The last 2^15 samples of a sine case are analysed, after the
+        // circuit has settled
+        constexpr int analysisOrder = 15;
+    }
+
+    //==============================================================================
+    juce::String GoldenCase::getFileName() const
+    {
+        return name + "_" + juce::String ((int) sampleRate) + ".wav";
+    }
+
+    juce::String GoldenResult::toString() const
+    {
+        juce::String text;
+        text << goldenCase.getFileName().paddedRight (' ', 29) << (passed ? "pass  " : "FAIL  ");
+
+        if (error.isNotEmpty())
+            return text + error;
+
+        text << "max error " << juce::String (maxAbsError, 7);
+
+        if (hasSpectrum)
+            text << ", THD " << juce::String (rendered.thdDb, 2) << " dB (golden " << juce::String (golden.thdDb, 2) << ")"
+                 << ", aliasing " << juce::String (rendered.aliasingDb, 2) << " dB (golden " << juce::String (golden.aliasingDb, 2) << ")";
+
+        return text;
+    }
+
+    juce::Array<double> getGoldenSampleRates()
+    {
+        return { 44100.0, 48000.0, 96000.0, 192000.0 };
+    }
+
+    juce::Array<GoldenCase> getGoldenCases (const juce::Array<double>& sampleRates, GoldenSet set)
+    {
+        juce::Array<GoldenCase> cases;
+
+        const auto add = [&cases] (const juce::String& name, Signal signal, double sampleRate, int numChannels, double seconds,
+                                   juce::Array<ParameterValue> parameters, bool doublePrecision = false)
+        {
+            cases.add ({ name, signal, sampleRate, numChannels, seconds, std::move (parameters), doublePrecision });
+        };
+
+        for (auto sampleRate : sampleRates)
+        {
+            if (set == GoldenSet::oversampled)
+            {
+                add ("sine997_4x", Signal::sine,  sampleRate, 1, sineSeconds,   { { ID::oversamplingFactor, 2.0f } });
+                add ("sweep_2x",   Signal::sweep, sampleRate, 2, stereoSeconds, { { ID::oversamplingFactor, 1.0f } });
+                continue;
+            }
+
+            const ParameterValue noOversampling { ID::oversamplingFactor, 0.0f };
+
+            add ("sine997", Signal::sine,  sampleRate, 1, sineSeconds,   { noOversampling });
+            add ("sweep",   Signal::sweep, sampleRate, 2, stereoSeconds, { noOversampling });
+            add ("drums",   Signal::drums, sampleRate, 2, stereoSeconds, { noOversampling });
+
+            // The nodal circuit is the default, so the cases above cover it
+            const char* circuitNames[] = { "wdf", "symmetric", "asymmetric", "adaa1", "adaa2" };
+
+            for (int circuit = 1; circuit <= 5; ++circuit)
+                add (juce::String ("sweep_") + circuitNames[circuit - 1], Signal::sweep, sampleRate, 1, variantSeconds,
+                     { noOversampling, { ID::circuitModel, (float) circuit } });
+
+            add ("sweep_table",  Signal::sweep, sampleRate, 1, variantSeconds, { noOversampling, { ID::solverMode, 1.0f } });
+            add ("sweep_mixed",  Signal::sweep, sampleRate, 1, variantSeconds, { noOversampling, { ID::solverPrecision, 1.0f } });
+            add ("sweep_double", Signal::sweep, sampleRate, 1, variantSeconds, { noOversampling }, true);
+        }
+
+        return cases;
+    }
+
+    bool renderGoldenCase (const GoldenCase& goldenCase, const Settings& settings,
+                           const juce::Array<ParameterValue>& parameters, juce::AudioBuffer<float>& output)
+    {
+        output.setSize (goldenCase.numChannels, (int) (goldenCase.seconds * goldenCase.sampleRate));
+
+        if (goldenCase.signal == Signal::sine)
+        {
+            for (int i = 0; i < output.getNumSamples(); ++i)
+                for (int channel = 0; channel < output.getNumChannels(); ++channel)
+                    output.setSample (channel, i, (float) (0.5 * std::sin (juce::MathConstants<double>::twoPi * sineFrequency * (double) i / goldenCase.sampleRate)));
+        }
+        else
+        {
+            generate (goldenCase.signal, output, goldenCase.sampleRate);
+        }
+
+        for (int channel = 1; channel < output.getNumChannels(); ++channel)
+            output.applyGain (channel, 0, output.getNumSamples(), 0.5f);
+
+        Settings caseSettings = settings;
+        caseSettings.sampleRate = goldenCase.sampleRate;
+        caseSettings.numChannels = goldenCase.numChannels;
+        caseSettings.timeStages = false;
+        caseSettings.doublePrecision = settings.doublePrecision || goldenCase.doublePrecision;
+
+        Engine engine (caseSettings);
+        juce::String unknownId;
+
+        if (! engine.setParameters (parameters, unknownId) || ! engine.setParameters (goldenCase.parameters, unknownId))
+            return false;
+
+        // The governor follows wall-clock load, which would make the output
+        // depend on what else is running
+        engine.setParameter (ID::adaptiveQuality, 0.0f);
+
+        engine.prepare();
+        engine.process (output);
+        return true;
+    }
+
+    SpectrumMetrics analyseSine (const float* samples, int numSamples, double sampleRate, double frequency)
+    {
+        constexpr int size = 1 << analysisOrder;
+        SpectrumMetrics metrics;
+
+        if (numSamples < size)
+            return metrics;
+
+        // Blackman-Harris leaks less than -90 dB outside 4 bins either side
+        // of a component
+        constexpr int halfWidth = 6;
+
+        std::vector<float> data (2 * size, 0.0f);
+        std::copy (samples + numSamples - size, samples + numSamples, data.begin());
+
+        juce::dsp::WindowingFunction<float> window ((size_t) size, juce::dsp::WindowingFunction<float>::blackmanHarris, false);
+        window.multiplyWithWindowingTable (data.data(), (size_t) size);
+
+        juce::dsp::FFT fft (analysisOrder);
+        fft.performFrequencyOnlyForwardTransform (data.data());
+
+        const auto numBins = size / 2 + 1;
+        const auto binWidth = sampleRate / (double) size;
+        std::vector<bool> claimed ((size_t) numBins, false);
+        double fundamental = 0.0, harmonics = 0.0, other = 0.0;
+
+        for (int k = 1; k * frequency < sampleRate * 0.5; ++k)
+        {
+            const auto centre = (int) std::round (k * frequency / binWidth);
+
+            for (int bin = juce::jmax (0, centre - halfWidth); bin <= juce::jmin (numBins - 1, centre + halfWidth); ++bin)
+            {
+                if (claimed[(size_t) bin])
+                    continue;
+
+                const auto power = (double) data[(size_t) bin] * (double) data[(size_t) bin];
+                (k == 1 ? fundamental : harmonics) += power;
+                claimed[(size_t) bin] = true;
+            }
+        }
+
+        // Skips DC and the window's leakage around it
+        for (int bin = halfWidth + 1; bin < numBins; ++bin)
+            if (! claimed[(size_t) bin])
+                other += (double) data[(size_t) bin] * (double) data[(size_t) bin];
+
+        if (fundamental <= 0.0)
+            return metrics;
+
+        const auto toDb = [fundamental] (double power)
+        {
+            return power > 0.0 ? juce::jmax (SpectrumMetrics::floorDb, 10.0 * std::log10 (power / fundamental))
+                               : SpectrumMetrics::floorDb;
+        };
+
+        metrics.thdDb = toDb (harmonics);
+        metrics.aliasingDb = toDb (other);
+        return metrics;
+    }
+
+    std::vector<GoldenResult> runGolden (const juce::File& directory, bool record, const Settings& settings,
+                                         const juce::Array<ParameterValue>& parameters, const GoldenTolerances& tolerances,
+                                         const juce::Array<double>& sampleRates, GoldenSet set)
+    {
+        std::vector<GoldenResult> results;
+
+        for (auto& goldenCase : getGoldenCases (sampleRates, set))
+        {
+            GoldenResult result;
+            result.goldenCase = goldenCase;
+
+            juce::AudioBuffer<float> rendered;
+
+            if (! renderGoldenCase (goldenCase, settings, parameters, rendered))
+            {
+                result.error = "unknown parameter";
+                results.push_back (result);
+                continue;
+            }
+
+            const auto file = directory.getChildFile (goldenCase.getFileName());
+
+            if (record)
+            {
+                result.passed = writeWav (file, rendered, goldenCase.sampleRate);
+                result.error = result.passed ? "recorded" : "could not write " + file.getFullPathName();
+                results.push_back (result);
+                continue;
+            }
+
+            juce::AudioBuffer<float> golden;
+            double goldenRate = 0.0;
+
+            if (! readWav (file, golden, goldenRate))
+            {
+                result.error = "no golden file";
+                result.missing = true;
+            }
+            else if (goldenRate != goldenCase.sampleRate || golden.getNumSamples() != rendered.getNumSamples()
+                     || golden.getNumChannels() != rendered.getNumChannels())
+            {
+                result.error = "golden file has a different format, record it again";
+            }
+
+            if (result.error.isNotEmpty())
+            {
+                results.push_back (result);
+                continue;
+            }
+
+            for (int channel = 0; channel < rendered.getNumChannels(); ++channel)
+            {
+                const auto* a = rendered.getReadPointer (channel);
+                const auto* b = golden.getReadPointer (channel);
+
+                for (int i = 0; i < rendered.getNumSamples(); ++i)
+                    result.maxAbsError = juce::jmax (result.maxAbsError, std::abs ((double) a[i] - (double) b[i]));
+            }
+
+            result.passed = result.maxAbsError <= tolerances.maxAbsError;
+
+            if (goldenCase.signal == Signal::sine)
+            {
+                result.hasSpectrum = true;
+                result.rendered = analyseSine (rendered.getReadPointer (0), rendered.getNumSamples(), goldenCase.sampleRate, sineFrequency);
+                result.golden   = analyseSine (golden.getReadPointer (0),   golden.getNumSamples(),   goldenCase.sampleRate, sineFrequency);
+
+                result.passed = result.passed
+                             && std::abs (result.rendered.thdDb - result.golden.thdDb) <= tolerances.thdDb
+                             && std::abs (result.rendered.aliasingDb - result.golden.aliasingDb) <= tolerances.aliasingDb;
+            }
+
+            results.push_back (result);
+        }
+
+        return results;
+    }
+}
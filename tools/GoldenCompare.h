@@ -0,0 +1,91 @@
+#pragma once
+
+#include "RenderEngine.h"
+
+// Renders a fixed set of reference signals at 44.1, 48, 96 and 192 kHz and
+// compares them with golden renders recorded earlier, so a change to the
+// solvers or diode functions can be checked for changes to the sound.
+//
+// The sweep and drum cases are stereo, with the right channel 6 dB down so
+// the channels' states differ. Shorter mono sweeps cover each of the other
+// circuits, the table and mixed precision solvers, and double precision
+// blocks. These all run without oversampling, so they don't depend on
+// JUCE's filter designs; the oversampled cases are a separate set.
+//
+// Every case is compared sample by sample. The sine cases also compare their
+// THD and the energy outside the harmonics, which is mostly aliasing, as
+// those move less than the waveform under an approximation that sounds the
+// same.
+namespace Render
+{
+    struct GoldenCase
+    {
+        juce::String name;
+        Signal signal;
+        double sampleRate;
+        int numChannels = 1;
+        double seconds = 1.0;
+
+        // Applied after the command line's, so they take precedence
+        juce::Array<ParameterValue> parameters;
+        bool doublePrecision = false;
+
+        juce::String getFileName() const;
+    };
+
+    struct GoldenTolerances
+    {
+        double maxAbsError = 1.0e-3;
+        double thdDb = 0.5;
+        double aliasingDb = 3.0;
+    };
+
+    // Relative to the fundamental. Levels below floorDb count as floorDb.
+    struct SpectrumMetrics
+    {
+        static constexpr double floorDb = -140.0;
+
+        double thdDb = floorDb;
+        double aliasingDb = floorDb;
+    };
+
+    struct GoldenResult
+    {
+        GoldenCase goldenCase;
+        bool passed = false;
+        bool missing = false;
+        juce::String error;
+        double maxAbsError = 0.0;
+        bool hasSpectrum = false;
+        SpectrumMetrics golden, rendered;
+
+        juce::String toString() const;
+    };
+
+    // 44.1, 48, 96 and 192 kHz
+    juce::Array<double> getGoldenSampleRates();
+
+    enum class GoldenSet
+    {
+        circuits,
+        oversampled
+    };
+
+    // The sine cases are 997 Hz, so that harmonics folding back from above
+    // Nyquist land between the harmonics at every sample rate
+    juce::Array<GoldenCase> getGoldenCases (const juce::Array<double>& sampleRates = getGoldenSampleRates(),
+                                            GoldenSet set = GoldenSet::circuits);
+
+    // Returns false if a parameter ID is unknown
+    bool renderGoldenCase (const GoldenCase& goldenCase, const Settings& settings,
+                           const juce::Array<ParameterValue>& parameters, juce::AudioBuffer<float>& output);
+
+    SpectrumMetrics analyseSine (const float* samples, int numSamples, double sampleRate, double frequency);
+
+    // Records every case at the given rates into directory, or compares them
+    // against the recordings there
+    std::vector<GoldenResult> runGolden (const juce::File& directory, bool record, const Settings& settings,
+                                         const juce::Array<ParameterValue>& parameters, const GoldenTolerances& tolerances,
+                                         const juce::Array<double>& sampleRates = getGoldenSampleRates(),
+                                         GoldenSet set = GoldenSet::circuits);
+}
@@ -0,0 +1,330 @@
+#include "BatchRender.h"
+#include "AliasingAnalysis.h"
+
+#include <iostream>
+
+namespace
+{
+    // The golden tests' SKIP_RETURN_CODE in CMakeLists.txt
+    constexpr int missingGoldenExitCode = 77;
+
+    void printUsage()
+    {
+        std::cout << "Usage: SYNRender [options]" << std::endl
+                  << "  --input=<file.wav>       Render a WAV file (sets rate and channels)" << std::endl
+                  << "  --signal=<name>          Synthetic input: sine, sweep, noise, drums [sweep]" << std::endl
+                  << "  --output=<file.wav>      Write the rendered audio" << std::endl
+                  << "  --rate=<Hz>              Sample rate for synthetic input [48000]" << std::endl
+                  << "  --channels=<n>           Channels for synthetic input [2]" << std::endl
+                  << "  --seconds=<s>            Length of synthetic input [10]" << std::endl
+                  << "  --block=<n>              Host block size [512]" << std::endl
+                  << "  --sub-block=<n>          Most samples the processor oversamples at once [512]" << std::endl
+                  << "  --param=<id>:<value>     Set a parameter by ID to a plain value, repeatable" << std::endl
+                  << "  --repeat=<n>             Render n times and report each run [1]" << std::endl
+                  << "  --stages                 Time the distortion processor without processBlock" << std::endl
+                  << "  --double                 Process double precision blocks" << std::endl
+                  << "  --batch=<dir>            Render every WAV file in a directory, in parallel" << std::endl
+                  << "  --output-dir=<dir>       Where --batch writes its files" << std::endl
+                  << "  --threads=<n>            Threads for --batch [number of cores]" << std::endl
+                  << "  --golden=<dir>           Compare reference renders with the golden files in a directory" << std::endl
+                  << "  --record                 Write the golden files instead of comparing" << std::endl
+                  << "  --golden-rates=<Hz,...>  Only the golden cases at these rates [44100,48000,96000,192000]" << std::endl
+                  << "  --oversampled            The oversampled golden cases instead of the others" << std::endl
+                  << "  --max-error=<x>          Largest sample difference from the golden files [0.001]" << std::endl
+                  << "  --thd-db=<dB>            Largest THD difference on the sine cases [0.5]" << std::endl
+                  << "  --aliasing-db=<dB>       Largest aliasing difference on the sine cases [3]" << std::endl
+                  << "  --aliasing               Measure aliasing over drive, frequency and oversampling" << std::endl
+                  << "  --target-db=<dB>         Aliasing target for --aliasing [-80]" << std::endl
+                  << "  --table=<file.h>         Write the lowest oversampling per drive as a header" << std::endl;
+    }
+
+    juce::String getOption (const juce::ArgumentList& args, const juce::String& name, const juce::String& fallback)
+    {
+        for (auto& arg : args.arguments)
+            if (arg.isLongOption (name))
+                return arg.getLongOptionValue();
+
+        return fallback;
+    }
+
+    bool parseParameters (const juce::ArgumentList& args, juce::Array<Render::ParameterValue>& parameters)
+    {
+        for (auto& arg : args.arguments)
+        {
+            if (! arg.isLongOption ("param"))
+                continue;
+
+            const auto value = arg.getLongOptionValue();
+
+            if (! value.contains (":"))
+                return false;
+
+            parameters.add ({ value.upToFirstOccurrenceOf (":", false, false),
+                              value.fromFirstOccurrenceOf (":", false, false).getFloatValue() });
+        }
+
+        return true;
+    }
+
+    int runBatch (const juce::ArgumentList& args, const Render::Settings& settings, const juce::Array<Render::ParameterValue>& parameters)
+    {
+        const auto cwd = juce::File::getCurrentWorkingDirectory();
+        const auto inputDirectory = cwd.getChildFile (getOption (args, "batch", {}));
+        const auto outputPath = getOption (args, "output-dir", {});
+
+        if (! inputDirectory.isDirectory() || outputPath.isEmpty())
+        {
+            std::cerr << "--batch needs an input directory and --output-dir" << std::endl;
+            return 1;
+        }
+
+        const auto outputDirectory = cwd.getChildFile (outputPath);
+
+        if (outputDirectory == inputDirectory || ! outputDirectory.createDirectory())
+        {
+            std::cerr << "Could not use " << outputPath << " as the output directory" << std::endl;
+            return 1;
+        }
+
+        const auto jobs = Render::findBatchJobs (inputDirectory, outputDirectory);
+        const auto threads = getOption (args, "threads", juce::String (juce::SystemStats::getNumCpus())).getIntValue();
+        const auto report = Render::renderBatch (jobs, settings, parameters, threads);
+
+        for (size_t i = 0; i < report.results.size(); ++i)
+            if (! report.results[i].rendered)
+                std::cerr << jobs.getReference ((int) i).input.getFileName() << ": " << report.results[i].error << std::endl;
+
+        std::cout << report.toString() << std::endl;
+        return report.getNumFailed() == 0 ? 0 : 1;
+    }
+
+    int checkGolden (const juce::ArgumentList& args, const Render::Settings& settings, const juce::Array<Render::ParameterValue>& parameters)
+    {
+        const auto directory = juce::File::getCurrentWorkingDirectory().getChildFile (getOption (args, "golden", {}));
+        const auto record = args.containsOption ("--record");
+
+        if (record && ! directory.createDirectory())
+        {
+            std::cerr << "Could not create " << directory.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        auto sampleRates = Render::getGoldenSampleRates();
+        const auto ratesOption = getOption (args, "golden-rates", {});
+
+        if (ratesOption.isNotEmpty())
+        {
+            sampleRates.clearQuick();
+
+            for (auto& token : juce::StringArray::fromTokens (ratesOption, ",", {}))
+            {
+                const auto rate = token.getDoubleValue();
+
+                if (rate <= 0.0)
+                {
+                    std::cerr << "Unknown sample rate " << token << " in --golden-rates" << std::endl;
+                    return 1;
+                }
+
+                sampleRates.add (rate);
+            }
+        }
+
+        Render::GoldenTolerances tolerances;
+        tolerances.maxAbsError = getOption (args, "max-error", juce::String (tolerances.maxAbsError)).getDoubleValue();
+        tolerances.thdDb = getOption (args, "thd-db", juce::String (tolerances.thdDb)).getDoubleValue();
+        tolerances.aliasingDb = getOption (args, "aliasing-db", juce::String (tolerances.aliasingDb)).getDoubleValue();
+
+        const auto set = args.containsOption ("--oversampled") ? Render::GoldenSet::oversampled
+                                                               : Render::GoldenSet::circuits;
+        int failed = 0, missing = 0;
+
+        for (auto& result : Render::runGolden (directory, record, settings, parameters, tolerances, sampleRates, set))
+        {
+            std::cout << result.toString() << std::endl;
+
+            if (! result.passed)
+                ++failed;
+
+            if (result.missing)
+                ++missing;
+        }
+
+        // A set with no golden files yet hasn't been recorded, which CTest
+        // reports as skipped rather than failed
+        if (failed > 0 && missing == failed)
+        {
+            std::cout << missing << " golden files missing, record them with --record" << std::endl;
+            return missingGoldenExitCode;
+        }
+
+        if (failed > 0)
+            std::cout << failed << " cases failed" << std::endl;
+
+        return failed == 0 ? 0 : 1;
+    }
+
+    int runAliasing (const juce::ArgumentList& args, const Render::Settings& settings, const juce::Array<Render::ParameterValue>& parameters)
+    {
+        Render::AliasingSettings aliasingSettings;
+        aliasingSettings.sampleRate = settings.sampleRate;
+        aliasingSettings.blockSize = settings.blockSize;
+        aliasingSettings.targetDb = getOption (args, "target-db", juce::String (aliasingSettings.targetDb)).getDoubleValue();
+
+        Render::AliasingReport report;
+
+        if (! Render::analyseAliasing (aliasingSettings, parameters, report))
+        {
+            std::cerr << "Unknown parameter" << std::endl;
+            return 1;
+        }
+
+        std::cout << report.toString() << std::endl;
+
+        const auto tablePath = getOption (args, "table", {});
+
+        if (tablePath.isNotEmpty() && ! juce::File::getCurrentWorkingDirectory().getChildFile (tablePath).replaceWithText (report.toHeader()))
+        {
+            std::cerr << "Could not write " << tablePath << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    Render::Settings settings;
+    settings.sampleRate = getOption (args, "rate", "48000").getDoubleValue();
+    settings.numChannels = getOption (args, "channels", "2").getIntValue();
+    settings.blockSize = getOption (args, "block", "512").getIntValue();
+    settings.subBlockSize = getOption (args, "sub-block", juce::String (settings.subBlockSize)).getIntValue();
+    settings.timeStages = args.containsOption ("--stages");
+    settings.doublePrecision = args.containsOption ("--double");
+
+    juce::Array<Render::ParameterValue> parameters;
+
+    if (! parseParameters (args, parameters))
+    {
+        std::cerr << "Parameters are set with --param=<id>:<value>" << std::endl;
+        return 1;
+    }
+
+    if (getOption (args, "batch", {}).isNotEmpty())
+    {
+        if (settings.blockSize <= 0)
+        {
+            printUsage();
+            return 1;
+        }
+
+        return runBatch (args, settings, parameters);
+    }
+
+    if (getOption (args, "golden", {}).isNotEmpty())
+    {
+        if (settings.blockSize <= 0)
+        {
+            printUsage();
+            return 1;
+        }
+
+        return checkGolden (args, settings, parameters);
+    }
+
+    if (args.containsOption ("--aliasing"))
+    {
+        if (settings.sampleRate <= 0.0 || settings.blockSize <= 0)
+        {
+            printUsage();
+            return 1;
+        }
+
+        return runAliasing (args, settings, parameters);
+    }
+
+    // An input file's rate and channel count replace the options, so those
+    // are checked once it has been read
+    juce::AudioBuffer<float> source;
+    const auto inputPath = getOption (args, "input", {});
+    const auto seconds = getOption (args, "seconds", "10").getDoubleValue();
+
+    if (settings.blockSize <= 0 || (inputPath.isEmpty() && (settings.sampleRate <= 0.0 || settings.numChannels <= 0 || seconds <= 0.0)))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (inputPath.isNotEmpty())
+    {
+        if (! Render::readWav (juce::File::getCurrentWorkingDirectory().getChildFile (inputPath), source, settings.sampleRate))
+        {
+            std::cerr << "Could not read " << inputPath << std::endl;
+            return 1;
+        }
+
+        settings.numChannels = source.getNumChannels();
+
+        if (settings.sampleRate <= 0.0 || settings.numChannels <= 0)
+        {
+            std::cerr << inputPath << " has no audio" << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        Render::Signal signal;
+
+        if (! Render::parseSignal (getOption (args, "signal", "sweep"), signal))
+        {
+            std::cerr << "Unknown signal" << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        source.setSize (settings.numChannels, (int) (seconds * settings.sampleRate));
+        Render::generate (signal, source, settings.sampleRate);
+    }
+
+    const auto repeats = juce::jmax (1, getOption (args, "repeat", "1").getIntValue());
+    juce::AudioBuffer<float> audio;
+
+    for (int run = 0; run < repeats; ++run)
+    {
+        Render::Engine engine (settings);
+        juce::String unknownId;
+
+        if (! engine.setParameters (parameters, unknownId))
+        {
+            std::cerr << "Unknown parameter " << unknownId << std::endl;
+            return 1;
+        }
+
+        engine.prepare();
+
+        audio.makeCopyOf (source);
+        const auto report = engine.process (audio);
+
+        std::cout << "run " << run + 1 << ": " << report.toString() << std::endl;
+    }
+
+    const auto outputPath = getOption (args, "output", {});
+
+    if (outputPath.isNotEmpty() && ! Render::writeWav (juce::File::getCurrentWorkingDirectory().getChildFile (outputPath), audio, settings.sampleRate))
+    {
+        std::cerr << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
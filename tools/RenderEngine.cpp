@@ -0,0 +1,264 @@
+#include "RenderEngine.h"
+
+namespace Render
+{
+    //==============================================================================
+    double Report::getNanosecondsPerSample() const
+    {
+        return numSamples > 0 ? seconds * 1.0e9 / (double) numSamples : 0.0;
+    }
+
+    double Report::getRealTimeFactor() const
+    {
+        return seconds > 0.0 ? ((double) numSamples / sampleRate) / seconds : 0.0;
+    }
+
+    juce::String Report::toString() const
+    {
+        juce::String text;
+
+        text << numSamples << " samples x " << numChannels << " channels @ " << sampleRate << " Hz" << juce::newLine
+             << "total        " << juce::String (seconds * 1000.0, 3) << " ms, "
+             << juce::String (getNanosecondsPerSample(), 2) << " ns/sample, "
+             << juce::String (getRealTimeFactor(), 1) << "x real time" << juce::newLine;
+
+        const char* stageNames[numStages] = { "distortion" };
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            if (stageSeconds[stage] <= 0.0)
+                continue;
+
+            text << juce::String (stageNames[stage]).paddedRight (' ', 13)
+                 << juce::String (stageSeconds[stage] * 1.0e9 / (double) numSamples, 2) << " ns/sample" << juce::newLine;
+        }
+
+        return text;
+    }
+
+    //==============================================================================
+    bool parseSignal (const juce::String& name, Signal& signal)
+    {
+        if (name == "sine")  { signal = Signal::sine;  return true; }
+        if (name == "sweep") { signal = Signal::sweep; return true; }
+        if (name == "noise") { signal = Signal::noise; return true; }
+        if (name == "drums") { signal = Signal::drums; return true; }
+
+        return false;
+    }
+
+    void generate (Signal signal, juce::AudioBuffer<float>& buffer, double sampleRate, juce::int64 seed)
+    {
+        constexpr auto twoPi = juce::MathConstants<double>::twoPi;
+        const auto numSamples = buffer.getNumSamples();
+        juce::Random random (seed);
+
+        buffer.clear();
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto t = (double) i / sampleRate;
+            double value = 0.0;
+
+            switch (signal)
+            {
+                case Signal::sine:
+                    value = 0.5 * std::sin (twoPi * 1000.0 * t);
+                    break;
+
+                case Signal::sweep:
+                {
+                    // Exponential sweep from 20 Hz to 20 kHz (or 0.45 Fs)
+                    const auto duration = (double) numSamples / sampleRate;
+                    const auto f0 = 20.0, f1 = juce::jmin (20000.0, 0.45 * sampleRate);
+                    const auto k = std::log (f1 / f0);
+                    value = 0.5 * std::sin (twoPi * f0 * duration / k * (std::exp (k * t / duration) - 1.0));
+                    break;
+                }
+
+                case Signal::noise:
+                    value = 0.5 * (2.0 * random.nextDouble() - 1.0);
+                    break;
+
+                case Signal::drums:
+                {
+                    // Kick on every beat, snare on 2 and 4, hats on eighths at 120 BPM
+                    const auto beat = t * 2.0;
+                    const auto beatPhase = (beat - std::floor (beat)) * 0.5;
+                    const auto eighthPhase = (beat * 2.0 - std::floor (beat * 2.0)) * 0.25;
+                    const auto isBackbeat = ((int) std::floor (beat) % 2) == 1;
+
+                    const auto kick = std::sin (twoPi * (45.0 * beatPhase + 4.0 * (1.0 - std::exp (-beatPhase * 30.0))))
+                                        * std::exp (-beatPhase * 12.0);
+                    const auto noise = 2.0 * random.nextDouble() - 1.0;
+                    const auto snare = isBackbeat ? noise * std::exp (-beatPhase * 25.0) : 0.0;
+                    const auto hat = noise * std::exp (-eighthPhase * 200.0);
+
+                    value = 0.6 * kick + 0.3 * snare + 0.1 * hat;
+                    break;
+                }
+            }
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.setSample (channel, i, (float) value);
+        }
+    }
+
+    //==============================================================================
+    bool readWav (const juce::File& file, juce::AudioBuffer<float>& buffer, double& sampleRate)
+    {
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatReader> reader (format.createReaderFor (file.createInputStream().release(), true));
+
+        if (reader == nullptr)
+            return false;
+
+        buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&buffer, 0, (int) reader->lengthInSamples, 0, true, true);
+        sampleRate = reader->sampleRate;
+
+        return true;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWavWriter (const juce::File& file, double sampleRate, int numChannels)
+    {
+        file.deleteFile();
+
+        std::unique_ptr<juce::OutputStream> stream (file.createOutputStream());
+
+        if (stream == nullptr)
+            return nullptr;
+
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer (format.createWriterFor (stream.get(), sampleRate,
+                                                                                (unsigned int) numChannels,
+                                                                                32, {}, 0));
+
+        if (writer != nullptr)
+            stream.release();
+
+        return writer;
+    }
+
+    bool writeWav (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+    {
+        auto writer = createWavWriter (file, sampleRate, buffer.getNumChannels());
+        return writer != nullptr && writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+    }
+
+    //==============================================================================
+    Engine::Engine (const Settings& s)
+        : settings (s)
+    {
+        const auto channelSet = juce::AudioChannelSet::canonicalChannelSet (settings.numChannels);
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (channelSet.size() > 0 ? channelSet : juce::AudioChannelSet::discreteChannels (settings.numChannels));
+        layout.outputBuses.add (layout.inputBuses.getReference (0));
+
+        const auto supported = processor.setBusesLayout (layout);
+        jassert (supported);
+        juce::ignoreUnused (supported);
+    }
+
+    bool Engine::setParameter (const juce::String& parameterId, float plainValue)
+    {
+        for (auto* parameter : processor.getParameters())
+        {
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*> (parameter))
+            {
+                if (ranged->getParameterID() == parameterId)
+                {
+                    ranged->setValueNotifyingHost (ranged->convertTo0to1 (plainValue));
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    bool Engine::setParameters (const juce::Array<ParameterValue>& values, juce::String& unknownId)
+    {
+        for (auto& parameter : values)
+        {
+            if (! setParameter (parameter.id, parameter.value))
+            {
+                unknownId = parameter.id;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void Engine::prepare()
+    {
+        processor.setSubBlockSize (settings.subBlockSize);
+        processor.setProcessingPrecision (settings.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                                   : juce::AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails (settings.sampleRate, settings.blockSize);
+        processor.prepareToPlay (settings.sampleRate, settings.blockSize);
+    }
+
+    Report Engine::process (juce::AudioBuffer<float>& audio)
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        Report report;
+        report.numSamples = audio.getNumSamples();
+        report.numChannels = audio.getNumChannels();
+        report.sampleRate = settings.sampleRate;
+
+        if (settings.doublePrecision)
+        {
+            doubleAudio.makeCopyOf (audio);
+            processBlocks (doubleAudio, report);
+            audio.makeCopyOf (doubleAudio);
+        }
+        else
+        {
+            processBlocks (audio, report);
+        }
+
+        return report;
+    }
+
+    template <typename SampleType>
+    void Engine::processBlocks (juce::AudioBuffer<SampleType>& audio, Report& report)
+    {
+        auto& distortion = processor.getDistortionProcessor<SampleType>();
+        juce::dsp::AudioBlock<SampleType> audioBlock (audio);
+
+        const auto ticksToSeconds = [] (juce::int64 ticks)
+        {
+            return juce::Time::highResolutionTicksToSeconds (ticks);
+        };
+
+        for (int start = 0; start < audio.getNumSamples(); start += settings.blockSize)
+        {
+            const auto numSamples = juce::jmin (settings.blockSize, audio.getNumSamples() - start);
+
+            if (settings.timeStages)
+            {
+                auto block = audioBlock.getSubBlock ((size_t) start, (size_t) numSamples);
+                juce::dsp::ProcessContextReplacing<SampleType> context (block);
+
+                const auto t0 = juce::Time::getHighResolutionTicks();
+                distortion.process (context);
+                const auto seconds = ticksToSeconds (juce::Time::getHighResolutionTicks() - t0);
+
+                report.stageSeconds[distortionStage] += seconds;
+                report.seconds += seconds;
+            }
+            else
+            {
+                juce::AudioBuffer<SampleType> block (audio.getArrayOfWritePointers(), audio.getNumChannels(), start, numSamples);
+
+                const auto t0 = juce::Time::getHighResolutionTicks();
+                processor.processBlock (block, midi);
+                report.seconds += ticksToSeconds (juce::Time::getHighResolutionTicks() - t0);
+            }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "PluginProcessor.h"
+
+// Headless rendering through the same AudioPluginAudioProcessor that the
+// plugin uses, with wall-clock timing for the whole render and, optionally,
+// for its DistortionProcessor on its own.
+namespace Render
+{
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numChannels = 2;
+
+        // The processor's internal block size, see setSubBlockSize
+        int subBlockSize = (int) AudioPluginAudioProcessor::DistortionProcessor<float>::defaultSubBlockSize;
+
+        // Runs the distortion processor instead of calling processBlock, so
+        // it can be timed without the parameter and metering work
+        bool timeStages = false;
+
+        // Processes double blocks, as a host that asks for double precision
+        // would. The audio is converted before and after the timed blocks.
+        bool doublePrecision = false;
+    };
+
+    // The gains are fused into the distortion processor, so it is the only
+    // stage left to time apart from processBlock
+    enum StageIndex
+    {
+        distortionStage,
+        numStages
+    };
+
+    struct Report
+    {
+        juce::int64 numSamples = 0;
+        int numChannels = 0;
+        double sampleRate = 0.0;
+        double seconds = 0.0;
+        double stageSeconds[numStages] {};
+
+        double getNanosecondsPerSample() const;
+        double getRealTimeFactor() const;
+        juce::String toString() const;
+    };
+
+    enum class Signal
+    {
+        sine,
+        sweep,
+        noise,
+        drums
+    };
+
+    bool parseSignal (const juce::String& name, Signal& signal);
+    void generate (Signal signal, juce::AudioBuffer<float>& buffer, double sampleRate, juce::int64 seed = 1);
+
+    bool readWav (const juce::File& file, juce::AudioBuffer<float>& buffer, double& sampleRate);
+    bool writeWav (const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate);
+
+    // A 32-bit float WAV writer, replacing any existing file
+    std::unique_ptr<juce::AudioFormatWriter> createWavWriter (const juce::File& file, double sampleRate, int numChannels);
+
+    // A --param=<id>:<value> option
+    struct ParameterValue
+    {
+        juce::String id;
+        float value = 0.0f;
+    };
+
+    class Engine
+    {
+    public:
+        explicit Engine (const Settings& settings);
+
+        // Sets a parameter by ID using its plain value (dB, or a choice index)
+        bool setParameter (const juce::String& parameterId, float plainValue);
+
+        // Sets each parameter in turn, stopping at the first unknown ID
+        bool setParameters (const juce::Array<ParameterValue>& values, juce::String& unknownId);
+
+        // Prepares the processor, applying any parameters set so far
+        void prepare();
+
+        // Processes the buffer in place, block by block
+        Report process (juce::AudioBuffer<float>& audio);
+
+        AudioPluginAudioProcessor& getProcessor() noexcept { return processor; }
+
+    private:
+        template <typename SampleType>
+        void processBlocks (juce::AudioBuffer<SampleType>& audio, Report& report);
+
+        Settings settings;
+        AudioPluginAudioProcessor processor;
+        juce::MidiBuffer midi;
+        juce::AudioBuffer<double> doubleAudio;
+
+        JUCE_DECLARE_NON_COPYABLE (Engine)
+    };
+}